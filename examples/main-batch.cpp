@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <cstring>
+#include "nested_json/batch.hpp"
+
+// Usage: batch [-j THREADS] [--unordered] [--format text|tsv|ndjson] [--find OFFSET] FILE|PATTERN|- ...
+// Flattens all the files (or finds the path of the value at OFFSET in each of them) on a pool of
+// threads. Quoted patterns are expanded, and - reads more file names from the standard input.
+int main(int argc, char* argv[]) {
+  size_t threads = 0;
+  bool ordered = true;
+  std::string format = "text";
+  int want_offset = -1;
+  std::vector<std::string> patterns;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      char* end;
+      const long count = std::strtol(argv[++i], &end, 10);
+      if (end == argv[i] || *end != 0 || count <= 0) {
+        std::cerr << "Invalid number of threads: " << argv[i] << std::endl;
+        return 1;
+      }
+      threads = count;
+    } else if (std::strcmp(argv[i], "--unordered") == 0) {
+      ordered = false;
+    } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      format = argv[++i];
+    } else if (std::strcmp(argv[i], "--find") == 0 && i + 1 < argc) {
+      want_offset = atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-") == 0) {
+      std::string line;
+      while (std::getline(std::cin, line)) {
+        if (!line.empty()) {
+          patterns.push_back(line);
+        }
+      }
+    } else {
+      patterns.push_back(argv[i]);
+    }
+  }
+
+  size_t failed = 0;
+  const std::vector<std::string> files = nested_json::expand_file_patterns(patterns, failed);
+
+  if (want_offset >= 0) {
+    failed += nested_json::run_batch(files, threads, ordered, STDOUT_FILENO, [&]() {
+        return std::unique_ptr<nested_json::find_worker>(new nested_json::find_worker(want_offset));
+        });
+  } else if (format == "tsv") {
+    failed += nested_json::run_batch(files, threads, ordered, STDOUT_FILENO, []() {
+        return std::unique_ptr<nested_json::flatten_worker<nested_json::tsv_sink>>(new nested_json::flatten_worker<nested_json::tsv_sink>());
+        });
+  } else if (format == "ndjson") {
+    failed += nested_json::run_batch(files, threads, ordered, STDOUT_FILENO, []() {
+        return std::unique_ptr<nested_json::flatten_worker<nested_json::ndjson_sink>>(new nested_json::flatten_worker<nested_json::ndjson_sink>());
+        });
+  } else {
+    failed += nested_json::run_batch(files, threads, ordered, STDOUT_FILENO, []() {
+        return std::unique_ptr<nested_json::flatten_worker<nested_json::text_sink>>(new nested_json::flatten_worker<nested_json::text_sink>());
+        });
+  }
+
+  return failed == 0 ? 0 : 1;
+}
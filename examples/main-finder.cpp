@@ -1,23 +1,29 @@
-#include <fstream>
+#include <cstdlib>
 #include "nested_json/finder.hpp"
 
 int main(int argc, char* argv[]) {
-    // Read from a file
-    std::ifstream ifs(argv[1]);
-    std::string file_contents {
-        std::istreambuf_iterator<char>(ifs),
-            std::istreambuf_iterator<char>()
-    };
-
-    const char* json_obj = file_contents.c_str();
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " FILE OFFSET..." << std::endl;
+        return 1;
+    }
 
     int offset = atoi(argv[2]);
 
-    nested_json::finder finder_obj(json_obj, strlen(json_obj)-1, offset);
+    // Parse the file in place through a memory mapping
+    nested_json::finder finder_obj(std::string(argv[1]), offset);
+
+    if (argc == 3) {
+        std::string want_path = finder_obj.start();
+
+        std::cout << want_path << std::endl;
 
-    std::string want_path = finder_obj.start();
+        return 0;
+    }
 
-    std::cout << want_path << std::endl;
+    // Several offsets: the file is indexed once, and all the lookups use the index
+    for (int i = 2; i < argc; i++) {
+        std::cout << finder_obj.find(atoi(argv[i])) << std::endl;
+    }
 
     return 0;
 }
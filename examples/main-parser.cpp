@@ -1,17 +1,20 @@
-#include <fstream>
+#include <cstring>
 #include "nested_json/parser.hpp"
 
 int main(int argc, char* argv[]) {
-  // Read from a file
-  std::ifstream ifs(argv[1]);
-  std::string file_contents {
-    std::istreambuf_iterator<char>(ifs),
-      std::istreambuf_iterator<char>()
-  };
+  // Parse the file in place through a memory mapping
+  nested_json::parser parser{std::string(argv[1])};
 
-  const char* json_obj = file_contents.c_str();
-
-  nested_json::parser parser(json_obj, strlen(json_obj)-1);
+  // The output format is text by default, tsv or ndjson if given as second argument
+  std::unique_ptr<nested_json::sink> sink;
+  if (argc > 2 && std::strcmp(argv[2], "tsv") == 0) {
+    sink.reset(new nested_json::tsv_sink());
+  } else if (argc > 2 && std::strcmp(argv[2], "ndjson") == 0) {
+    sink.reset(new nested_json::ndjson_sink());
+  } else {
+    sink.reset(new nested_json::text_sink());
+  }
+  parser.set_sink(*sink);
 
   parser.start();
 
@@ -0,0 +1,202 @@
+#ifndef NESTED_JSON_BATCH_H
+#define NESTED_JSON_BATCH_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <exception>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+#include <iostream>
+
+#include <glob.h>
+#include <unistd.h>
+
+#include "minijson_reader.hpp"
+#include "parser.hpp"
+#include "finder.hpp"
+#include "sink.hpp"
+
+namespace nested_json {
+  // expands the patterns that contain wildcards (in sorted order, like the shell does), and
+  // keeps the other paths as they are. The patterns that match no file, or cannot be expanded,
+  // are reported on std::cerr and counted in failed.
+  inline std::vector<std::string> expand_file_patterns(const std::vector<std::string>& patterns, size_t& failed) {
+    std::vector<std::string> files;
+    for (const std::string& pattern : patterns) {
+      if (pattern.find_first_of("*?[") == std::string::npos) {
+        files.push_back(pattern);
+        continue;
+      }
+
+      glob_t matches;
+      const int result = glob(pattern.c_str(), 0, NULL, &matches);
+      if (result == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) {
+          files.push_back(matches.gl_pathv[i]);
+        }
+      } else {
+        failed++;
+        std::cerr << pattern << ": " << (result == GLOB_NOMATCH ? "No matching file" : "Cannot expand the pattern") << std::endl;
+      }
+      globfree(&matches);
+    }
+
+    return files;
+  }
+
+  // Processes the files on a fixed pool of threads, each of which takes the next file as soon as
+  // it is done with the previous one. make_worker() is called once per thread, and the worker it
+  // returns (as a std::unique_ptr) is reused for all the files of the thread, with the same
+  // contexts and buffers:
+  //   void operator()(const std::string& file_path, std::string& output);
+  // The output of every file is written to fd in one piece, in the order of the files if ordered
+  // is true, as soon as it is complete otherwise. The files that cannot be parsed are reported
+  // on std::cerr, and skipped. Returns the number of such files.
+  template<typename MakeWorker>
+  size_t run_batch(const std::vector<std::string>& files, size_t thread_count, bool ordered, int fd, MakeWorker make_worker) {
+    if (thread_count == 0) {
+      thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    thread_count = std::min(thread_count, std::max<size_t>(files.size(), 1));
+
+    std::atomic<size_t> next_file(0);
+    std::atomic<size_t> failed(0);
+    std::mutex mutex; // protects fd, std::cerr and what follows
+    std::exception_ptr exception;
+    size_t next_to_write = 0; // ordered mode: the outputs that can't be written yet are stored
+    std::vector<std::string> pending(ordered ? files.size() : 0);
+    std::vector<bool> done(ordered ? files.size() : 0, false);
+
+    auto run = [&]() {
+      try {
+        const auto worker = make_worker();
+        std::string output;
+        for (size_t i; (i = next_file++) < files.size(); ) {
+          output.clear();
+          std::string error;
+          try {
+            (*worker)(files[i], output);
+          } catch (const std::exception& e) {
+            output.clear();
+            error = e.what();
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error.empty()) {
+            failed++;
+            std::cerr << files[i] << ": " << error << std::endl;
+          }
+
+          if (!ordered) {
+            write_fd(fd, output.data(), output.size());
+          } else if (i != next_to_write) {
+            pending[i].swap(output);
+            done[i] = true;
+          } else {
+            write_fd(fd, output.data(), output.size());
+            for (next_to_write++; next_to_write < files.size() && done[next_to_write]; next_to_write++) {
+              write_fd(fd, pending[next_to_write].data(), pending[next_to_write].size());
+              std::string().swap(pending[next_to_write]);
+            }
+          }
+        }
+      } catch (...) { // the output can't be written: stop all the threads
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!exception) {
+          exception = std::current_exception();
+        }
+        next_file = files.size();
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; i++) {
+      threads.push_back(std::thread(run));
+    }
+    run();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+
+    return failed;
+  }
+
+  // flattens a file, as parser does, after a "==> file <==" line
+  template<typename Sink>
+  class flatten_worker {
+    protected:
+      parser m_parser;
+      std::string m_output;
+      std::unique_ptr<Sink> m_sink;
+
+    public:
+      flatten_worker() :
+        m_parser(std::string()),
+        m_sink(new Sink(m_output)) {
+          m_parser.set_sink(*m_sink);
+        }
+
+      void operator()(const std::string& file_path, std::string& output) {
+        m_output.clear();
+        m_output += "==> ";
+        m_output += file_path;
+        m_output += " <==\n";
+
+        m_parser.set_file(file_path);
+        try {
+          m_parser.start();
+        } catch (...) {
+          m_sink->discard();
+          throw;
+        }
+
+        output.swap(m_output);
+      }
+  }; // class flatten_worker
+
+  // finds the path of the value at the same offset in every file, as finder does, and
+  // writes it after the name of the file and a tab
+  class find_worker {
+    protected:
+      // finder also reports every value it passes, which is not needed here
+      class null_sink : public sink {
+        public:
+          null_sink() :
+            sink(STDOUT_FILENO, 1) {
+            }
+
+          void value(const path_view&, const minijson::value&) override {
+          }
+      }; // class null_sink
+
+      finder m_finder;
+      std::unique_ptr<null_sink> m_sink;
+
+    public:
+      explicit find_worker(int want_offset) :
+        m_finder(std::string(), want_offset),
+        m_sink(new null_sink()) {
+          m_finder.set_sink(*m_sink);
+        }
+
+      void operator()(const std::string& file_path, std::string& output) {
+        m_finder.set_file(file_path);
+        const std::string path = m_finder.start();
+
+        output += file_path;
+        output += '\t';
+        output += path;
+        output += '\n';
+      }
+  }; // class find_worker
+} // namespace nested_json
+
+#endif // NESTED_JSON_BATCH_H
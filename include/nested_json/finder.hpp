@@ -1,16 +1,22 @@
+#ifndef NESTED_JSON_FINDER_H
+#define NESTED_JSON_FINDER_H
+
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <memory>
 
 #include "minijson_reader.hpp"
 #include "parser.hpp"
+#include "offset_index.hpp"
 
 namespace nested_json {
   class finder : public parser {
     protected:
       int m_want_offset;
       std::string m_want_path;
+      std::unique_ptr<offset_index> m_index;
 
     public:
       explicit finder(
@@ -22,9 +28,17 @@ namespace nested_json {
           m_want_path = "";
         }
 
-      void handle_value(minijson::const_buffer_context &ctx, minijson::value &v) override {
-        if (ctx.read_offset() >= m_want_offset && m_want_path == "") {
-          m_want_path = parser::join(m_current_path, "");
+      explicit finder(
+          const std::string& file_path,
+          int want_offset) :
+        nested_json::parser(file_path),
+        m_want_offset(want_offset) {
+          m_want_path = "";
+        }
+
+      void handle_value(context_type &ctx, minijson::value &v) override {
+        if (ctx.read_offset() >= static_cast<size_t>(m_want_offset) && m_want_path == "") {
+          m_want_path = m_current_path.str();
           minijson::ignore(ctx);
           return;
         }
@@ -33,9 +47,32 @@ namespace nested_json {
       }
 
       std::string start() {
+        m_want_path = "";
         parser::start();
         return m_want_path;
       }
 
+      void set_file(const std::string& file_path) override {
+        parser::set_file(file_path);
+        m_index.reset();
+      }
+
+      // Indexed mode, for many lookups in the same document: it is parsed only once, by the first
+      // call, and the result is the same as start() would return for want_offset
+      std::string find(int want_offset) {
+        if (!m_index) {
+          if (m_json_string == NULL) {
+            m_index.reset(new offset_index(m_file_path));
+          } else {
+            m_index.reset(new offset_index(m_json_string, m_length));
+          }
+          m_index->build();
+        }
+
+        return m_index->path(want_offset);
+      }
+
   }; // class finder
 } // namespace nested_json
+
+#endif // NESTED_JSON_FINDER_H
@@ -0,0 +1,166 @@
+#ifndef NESTED_JSON_OFFSET_INDEX_H
+#define NESTED_JSON_OFFSET_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+#include "minijson_reader.hpp"
+#include "path_builder.hpp"
+
+namespace nested_json {
+  // All the values of a document, in the order they are parsed, with enough information to
+  // rebuild their paths: the document is parsed once, and every lookup is then a binary search
+  // followed by a walk up the parents of the value found. The names of the fields are not
+  // copied: the context that decoded them is kept with the index, and the entries refer to them
+  // by their offset in its write buffer. Offsets are 32-bit, so documents are limited to 2 GiB.
+  class offset_index {
+    public:
+      static const uint32_t NO_PARENT = 0xFFFFFFFF;
+      static const uint32_t ELEMENT = 0x80000000; // set in entry::segment for the elements of arrays
+      static const size_t MAX_LENGTH = ELEMENT;
+
+      struct entry {
+        uint32_t begin_offset; // the read offset when the value is handled: right after a scalar, after the opening bracket of an object or array
+        uint32_t end_offset; // right after the value
+        uint32_t parent; // NO_PARENT for the fields and elements of the document itself
+        uint32_t segment; // ELEMENT | the index for an element, where the decoded name begins for a field
+      };
+
+    protected:
+      // both const_buffer_context and mmap_file_context derive from it
+      typedef minijson::detail::buffer_context_base context_type;
+
+      const char* m_json_string;
+      int m_length;
+      std::string m_file_path;
+      std::unique_ptr<minijson::const_buffer_context> m_buffer_context;
+      std::unique_ptr<minijson::mmap_file_context> m_file_context;
+      const char* m_names; // the write buffer of the context, where the names are decoded
+      const char* m_root_segment;
+      std::vector<entry> m_entries;
+
+      void index_value(context_type &ctx, minijson::value &v, uint32_t parent, uint32_t segment) {
+        const uint32_t position = m_entries.size();
+        const entry e = { static_cast<uint32_t>(ctx.read_offset()), 0, parent, segment };
+        m_entries.push_back(e);
+
+        if (v.type() == minijson::Object) {
+          index_object(ctx, position);
+        } else if (v.type() == minijson::Array) {
+          index_array(ctx, position);
+        }
+
+        m_entries[position].end_offset = ctx.read_offset();
+      }
+
+      void index_array(context_type &ctx, uint32_t parent) {
+        uint32_t index = 0;
+        minijson::parse_array(ctx, [&](minijson::value v) {
+            index_value(ctx, v, parent, ELEMENT | index);
+            index++;
+            });
+      }
+
+      void index_object(context_type &ctx, uint32_t parent) {
+        minijson::parse_object(ctx, [&](const char *k, minijson::value v) {
+            index_value(ctx, v, parent, static_cast<uint32_t>(k - m_names));
+            });
+      }
+
+      void index(context_type &ctx) {
+        if (ctx.length() > MAX_LENGTH) {
+          throw std::runtime_error("The document is too large to be indexed");
+        }
+
+        m_names = ctx.write_buffer(); // nothing has been decoded yet
+        switch (ctx.toplevel_type()) {
+          case minijson::Array:
+            m_root_segment = ".";
+            index_array(ctx, NO_PARENT);
+            break;
+          case minijson::Object:
+            m_root_segment = "";
+            index_object(ctx, NO_PARENT);
+            break;
+          default:
+            throw std::runtime_error("Invalid JSON");
+        }
+      }
+
+    public:
+      explicit offset_index(const char* json_string, int length) :
+        m_json_string(json_string),
+        m_length(length),
+        m_names(NULL),
+        m_root_segment("") {
+        }
+
+      // the file stays mapped as long as the index exists
+      explicit offset_index(const std::string& file_path) :
+        m_json_string(NULL),
+        m_length(0),
+        m_file_path(file_path),
+        m_names(NULL),
+        m_root_segment("") {
+        }
+
+      // parses the document, unless it has already been indexed
+      void build() {
+        if (m_names != NULL) {
+          return;
+        }
+
+        if (m_json_string == NULL) {
+          m_file_context.reset(new minijson::mmap_file_context(m_file_path));
+          index(*m_file_context);
+        } else {
+          m_buffer_context.reset(new minijson::const_buffer_context(m_json_string, m_length));
+          index(*m_buffer_context);
+        }
+      }
+
+      const std::vector<entry>& entries() const {
+        return m_entries;
+      }
+
+      // the position in entries() of the first value handled at or after the offset,
+      // or entries().size() if there is none
+      size_t find(int want_offset) const {
+        const size_t offset = want_offset;
+        return std::lower_bound(m_entries.begin(), m_entries.end(), offset,
+            [](const entry& e, size_t offset) { return e.begin_offset < offset; }) - m_entries.begin();
+      }
+
+      // the same path as finder::start() returns for the offset ("" if there is none)
+      std::string path(int want_offset) const {
+        const size_t position = find(want_offset);
+        if (position == m_entries.size()) {
+          return "";
+        }
+
+        std::vector<uint32_t> ancestors;
+        for (uint32_t i = position; i != NO_PARENT; i = m_entries[i].parent) {
+          ancestors.push_back(i);
+        }
+
+        path_builder output;
+        output.push(m_root_segment);
+        for (size_t i = ancestors.size(); i-- > 0; ) {
+          const uint32_t segment = m_entries[ancestors[i]].segment;
+          if (segment & ELEMENT) {
+            output.push_index(segment & ~ELEMENT);
+          } else {
+            output.push_key(m_names + segment);
+          }
+        }
+
+        return output.str();
+      }
+  }; // class offset_index
+} // namespace nested_json
+
+#endif // NESTED_JSON_OFFSET_INDEX_H
@@ -1,25 +1,38 @@
+#ifndef NESTED_JSON_PARSER_H
+#define NESTED_JSON_PARSER_H
+
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <memory>
+#include <stdexcept>
 
 #include "minijson_reader.hpp"
+#include "path_builder.hpp"
+#include "sink.hpp"
 
 namespace nested_json {
   class parser {
     protected:
+      // both const_buffer_context and mmap_file_context derive from it
+      typedef minijson::detail::buffer_context_base context_type;
+
       const char* m_json_string;
       int m_length;
-      std::vector<std::string> m_current_path;
+      std::string m_file_path;
+      path_builder m_current_path;
+      sink* m_sink;
+      std::unique_ptr<sink> m_default_sink;
 
     protected:
-      virtual void handle_value(minijson::const_buffer_context &ctx, minijson::value &v) {
+      virtual void handle_value(context_type &ctx, minijson::value &v) {
         switch (v.type()) {
           case minijson::String:
           case minijson::Number:
           case minijson::Boolean:
           case minijson::Null:
-            handle_final(ctx, v);
+            handle_final(ctx, v, m_current_path.view());
             break;
           case minijson::Object:
             handle_object(ctx);
@@ -30,77 +43,99 @@ namespace nested_json {
         }
       }
 
-      void handle_array(minijson::const_buffer_context &ctx) {
+      void handle_array(context_type &ctx) {
         int index = 0;
         minijson::parse_array(ctx, [&](minijson::value v) {
-            m_current_path.push_back("[" + std::to_string(index) + "]");
+            m_current_path.push_index(index);
             handle_value(ctx, v);
-            m_current_path.pop_back();
+            m_current_path.pop();
 
             index++;
             });
       }
 
-      void handle_object(minijson::const_buffer_context &ctx) {
+      void handle_object(context_type &ctx) {
         minijson::parse_object(ctx, [&](const char *k, minijson::value v) {
-            m_current_path.push_back("." + std::string(k));
+            m_current_path.push_key(k);
             handle_value(ctx, v);
-            m_current_path.pop_back();
+            m_current_path.pop();
             });
       }
 
-      void handle_final(minijson::const_buffer_context &ctx, minijson::value &v) {
-        std::cout << join(m_current_path, "")
-          << " = "
-          << v.as_string()
-          << " ("
-          << minijson::value_type_string(v.type()).to_string()
-          << ")"
-          << std::endl;
+      void handle_final(context_type &, minijson::value &v, const path_view& path) {
+        m_sink->value(path, v);
       }
 
-      std::string join(std::vector<std::string> arr, std::string joining_string) {
-        std::string output;
-        for (int i = 0; i < (arr.size()-1); i++) {
-          output += arr[i];
-          output += joining_string;
-        }
-
-        output += arr[arr.size()-1];
-        return output;
-      }
-
-    public:
-      explicit parser(const char* json_string, int length) :
-        m_json_string(json_string),
-        m_length(length) {
+      void parse(context_type &ctx) {
+        if (m_sink == NULL) {
+          m_default_sink.reset(new text_sink());
+          m_sink = m_default_sink.get();
         }
 
-      void start() {
-        minijson::const_buffer_context ctx(m_json_string, m_length);
-
-        std::cout << "BEGIN" << std::endl;
+        m_current_path.clear(); // in case parsing the previous file failed
+        m_sink->begin();
 
         switch (ctx.toplevel_type()) {
           case minijson::Array:
-            m_current_path.push_back(".");
+            m_current_path.push(".");
             handle_array(ctx);
-            m_current_path.pop_back();
+            m_current_path.pop();
             break;
           case minijson::Object:
-            m_current_path.push_back("");
+            m_current_path.push("");
             handle_object(ctx);
-            m_current_path.pop_back();
+            m_current_path.pop();
             break;
           default:
             throw std::runtime_error("Invalid JSON");
         }
 
-        if (m_current_path.size() != 0) {
-          std::cout << "Final size is not 0 => something went wrong" << std::endl;
+        if (m_current_path.depth() != 0) {
+          // push() and pop() are balanced, and parsing errors are thrown
+          throw std::logic_error("Final size is not 0 => something went wrong");
         }
 
-        std::cout << "END" << std::endl;
+        m_sink->end();
+        m_sink->flush();
+      }
+
+    public:
+      explicit parser(const char* json_string, int length) :
+        m_json_string(json_string),
+        m_length(length),
+        m_sink(NULL) {
+        }
+
+      // parses the file in place through a memory mapping, without copying it
+      explicit parser(const std::string& file_path) :
+        m_json_string(NULL),
+        m_length(0),
+        m_file_path(file_path),
+        m_sink(NULL) {
+        }
+
+      // the values are written to output instead of standard output (by a text_sink)
+      void set_sink(sink& output) {
+        m_sink = &output;
+      }
+
+      // the next calls to start() will parse another file, reusing the buffers of this one
+      virtual void set_file(const std::string& file_path) {
+        m_json_string = NULL;
+        m_length = 0;
+        m_file_path = file_path;
+      }
+
+      void start() {
+        if (m_json_string == NULL) {
+          minijson::mmap_file_context ctx(m_file_path);
+          parse(ctx);
+        } else {
+          minijson::const_buffer_context ctx(m_json_string, m_length);
+          parse(ctx);
+        }
       }
   }; // class parser
 } // namespace nested_json
+
+#endif // NESTED_JSON_PARSER_H
@@ -0,0 +1,96 @@
+#ifndef NESTED_JSON_PATH_BUILDER_H
+#define NESTED_JSON_PATH_BUILDER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace nested_json {
+  // characters that are not null-terminated, valid until the path they come from changes
+  struct path_view {
+    const char* data;
+    size_t size;
+
+    std::string to_string() const {
+      return std::string(data, size);
+    }
+  };
+
+  inline std::ostream& operator<<(std::ostream& stream, const path_view& view) {
+    return stream.write(view.data, view.size);
+  }
+
+  // A path such as ".k4[1].u", built in a single buffer: segments are appended when descending
+  // and truncated when going back up, so once the buffer and the stack of segment offsets have
+  // grown to the depth of the document, no more memory is allocated.
+  class path_builder {
+    protected:
+      std::string m_buffer;
+      std::vector<size_t> m_offsets; // where each segment begins in m_buffer
+
+    public:
+      // e.g. "" or "." for the document itself
+      void push(const char* segment) {
+        m_offsets.push_back(m_buffer.size());
+        m_buffer += segment;
+      }
+
+      // ".key"
+      void push_key(const char* key) {
+        m_offsets.push_back(m_buffer.size());
+        m_buffer += '.';
+        m_buffer += key;
+      }
+
+      // "[index]"
+      void push_index(size_t index) {
+        m_offsets.push_back(m_buffer.size());
+
+        char digits[20];
+        size_t count = 0;
+        do {
+          digits[count++] = '0' + index % 10;
+          index /= 10;
+        } while (index != 0);
+
+        m_buffer += '[';
+        while (count > 0) {
+          m_buffer += digits[--count];
+        }
+        m_buffer += ']';
+      }
+
+      void pop() {
+        m_buffer.resize(m_offsets.back());
+        m_offsets.pop_back();
+      }
+
+      // removes all the segments, but keeps the memory
+      void clear() {
+        m_buffer.clear();
+        m_offsets.clear();
+      }
+
+      // the number of segments
+      size_t depth() const {
+        return m_offsets.size();
+      }
+
+      path_view view() const {
+        const path_view view = { m_buffer.data(), m_buffer.size() };
+        return view;
+      }
+
+      // the last segment
+      path_view back() const {
+        const path_view view = { m_buffer.data() + m_offsets.back(), m_buffer.size() - m_offsets.back() };
+        return view;
+      }
+
+      std::string str() const {
+        return m_buffer;
+      }
+  }; // class path_builder
+} // namespace nested_json
+
+#endif // NESTED_JSON_PATH_BUILDER_H
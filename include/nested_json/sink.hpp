@@ -0,0 +1,272 @@
+#ifndef NESTED_JSON_SINK_H
+#define NESTED_JSON_SINK_H
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "minijson_reader.hpp"
+#include "path_builder.hpp"
+
+namespace nested_json {
+  // writes all the data, unless write(2) fails
+  inline void write_fd(int fd, const char* data, size_t size) {
+    while (size > 0) {
+      const ssize_t written = ::write(fd, data, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error(std::string("Cannot write the output: ") + std::strerror(errno));
+      }
+
+      data += written;
+      size -= written;
+    }
+  }
+
+  // Where parser writes the values it finds, in some format: the output is accumulated in a
+  // large buffer, which is written to the file descriptor with a single write(2) call when full,
+  // and when the document has been parsed (or appended to a string, for batch processing).
+  class sink {
+    public:
+      static const size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    protected:
+      int m_fd;
+      std::string* m_output;
+      std::vector<char> m_buffer;
+      size_t m_size;
+
+      void write(const char* data, size_t size) {
+        if (size > m_buffer.size() - m_size) {
+          flush();
+          if (size > m_buffer.size()) {
+            output(data, size);
+            return;
+          }
+        }
+
+        std::memcpy(&m_buffer[m_size], data, size);
+        m_size += size;
+      }
+
+      void write(const char* str) {
+        write(str, std::strlen(str));
+      }
+
+      void write(const path_view& view) {
+        write(view.data, view.size);
+      }
+
+      void write(char c) {
+        if (m_size == m_buffer.size()) {
+          flush();
+        }
+
+        m_buffer[m_size++] = c;
+      }
+
+      void output(const char* data, size_t size) {
+        if (m_output != NULL) {
+          m_output->append(data, size);
+        } else {
+          write_fd(m_fd, data, size);
+        }
+      }
+
+      static const char* type_name(minijson::value_type type) {
+        switch (type) {
+          case minijson::String:
+            return "string";
+          case minijson::Number:
+            return "number";
+          case minijson::Boolean:
+            return "boolean";
+          case minijson::Object:
+            return "object";
+          case minijson::Array:
+            return "array";
+          case minijson::Null:
+            return "null";
+        }
+
+        return "invalid type";
+      }
+
+    public:
+      explicit sink(int fd = STDOUT_FILENO, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        m_fd(fd),
+        m_output(NULL),
+        m_buffer(buffer_size > 0 ? buffer_size : 1),
+        m_size(0) {
+        }
+
+      explicit sink(std::string& output, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        m_fd(-1),
+        m_output(&output),
+        m_buffer(buffer_size > 0 ? buffer_size : 1),
+        m_size(0) {
+        }
+
+      // the output is lost if flush() fails here
+      virtual ~sink() {
+        try {
+          flush();
+        } catch (const std::runtime_error&) {
+        }
+      }
+
+      virtual void begin() {
+      }
+
+      virtual void value(const path_view& path, const minijson::value& v) = 0;
+
+      virtual void end() {
+      }
+
+      void flush() {
+        const size_t size = m_size;
+        m_size = 0;
+        output(&m_buffer[0], size);
+      }
+
+      // drops the output that has not been written yet, e.g. when parsing fails
+      void discard() {
+        m_size = 0;
+      }
+  }; // class sink
+
+  // path = value (type), between BEGIN and END lines
+  class text_sink : public sink {
+    public:
+      explicit text_sink(int fd = STDOUT_FILENO, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        sink(fd, buffer_size) {
+        }
+
+      explicit text_sink(std::string& output, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        sink(output, buffer_size) {
+        }
+
+      void begin() override {
+        write("BEGIN\n");
+      }
+
+      void value(const path_view& path, const minijson::value& v) override {
+        write(path);
+        write(" = ");
+        write(v.as_string());
+        write(" (");
+        write(type_name(v.type()));
+        write(")\n");
+      }
+
+      void end() override {
+        write("END\n");
+      }
+  }; // class text_sink
+
+  // path, value and type separated by tabs, with tabs, newlines, carriage returns and
+  // backslashes escaped as \t, \n, \r and \\ (as in PostgreSQL's text format)
+  class tsv_sink : public sink {
+    protected:
+      void write_escaped(const char* data, size_t size) {
+        const char* run = data;
+        for (const char* p = data; p != data + size; p++) {
+          const char* escape = NULL;
+          switch (*p) {
+            case '\t': escape = "\\t"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            case '\\': escape = "\\\\"; break;
+          }
+
+          if (escape != NULL) {
+            write(run, p - run);
+            write(escape, 2);
+            run = p + 1;
+          }
+        }
+        write(run, data + size - run);
+      }
+
+    public:
+      explicit tsv_sink(int fd = STDOUT_FILENO, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        sink(fd, buffer_size) {
+        }
+
+      explicit tsv_sink(std::string& output, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        sink(output, buffer_size) {
+        }
+
+      void value(const path_view& path, const minijson::value& v) override {
+        write_escaped(path.data, path.size);
+        write('\t');
+        write_escaped(v.as_string(), std::strlen(v.as_string()));
+        write('\t');
+        write(type_name(v.type()));
+        write('\n');
+      }
+  }; // class tsv_sink
+
+  // {"path":"...","value":...}, one object per line
+  class ndjson_sink : public sink {
+    protected:
+      void write_json_string(const char* data, size_t size) {
+        static const char hex_digits[] = "0123456789abcdef";
+
+        write('"');
+        const char* run = data;
+        for (const char* p = data; p != data + size; p++) {
+          const unsigned char c = *p;
+          if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+          }
+
+          write(run, p - run);
+          run = p + 1;
+
+          switch (c) {
+            case '"': write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default: {
+              const char escape[] = { '\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0xF] };
+              write(escape, sizeof(escape));
+            }
+          }
+        }
+        write(run, data + size - run);
+        write('"');
+      }
+
+    public:
+      explicit ndjson_sink(int fd = STDOUT_FILENO, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        sink(fd, buffer_size) {
+        }
+
+      explicit ndjson_sink(std::string& output, size_t buffer_size = DEFAULT_BUFFER_SIZE) :
+        sink(output, buffer_size) {
+        }
+
+      void value(const path_view& path, const minijson::value& v) override {
+        write("{\"path\":");
+        write_json_string(path.data, path.size);
+        write(",\"value\":");
+        if (v.type() == minijson::String) {
+          write_json_string(v.as_string(), std::strlen(v.as_string()));
+        } else {
+          write(v.as_string()); // numbers as they were written, true, false and null
+        }
+        write("}\n");
+      }
+  }; // class ndjson_sink
+} // namespace nested_json
+
+#endif // NESTED_JSON_SINK_H
@@ -0,0 +1,298 @@
+#ifndef MINIJSON_NDJSON_H
+#define MINIJSON_NDJSON_H
+
+// parse_ndjson and parse_ndjson_ordered: newline-delimited JSON parsed on worker threads.
+// They are kept out of minijson_reader.hpp, so that its users don't get the threading headers,
+// and are only available in C++11 mode.
+
+#include "minijson_reader.hpp"
+
+#if !(MJR_CPP11_SUPPORTED)
+#error "minijson_ndjson.hpp requires C++11"
+#endif
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace minijson
+{
+
+namespace detail
+{
+
+// the number of threads to use when the client asks for 0
+inline size_t default_thread_count()
+{
+    const unsigned int threads = std::thread::hardware_concurrency();
+
+    return (threads != 0) ? threads : 1;
+}
+
+// the offsets at which the input is split into batches of whole lines (the first one
+// is 0 and the last one is length), each about batch_size bytes long
+inline std::vector<size_t> split_lines(const char* buffer, size_t length, size_t batch_size)
+{
+    std::vector<size_t> boundaries(1, 0);
+    while (boundaries.back() < length)
+    {
+        if (length - boundaries.back() <= batch_size)
+        {
+            boundaries.push_back(length);
+        }
+        else
+        {
+            const char* const newline = find_byte(buffer + boundaries.back() + batch_size, buffer + length, '\n');
+            boundaries.push_back((newline != buffer + length) ? newline - buffer + 1 : length);
+        }
+    }
+
+    return boundaries;
+}
+
+inline size_t default_batch_size(size_t length, size_t threads)
+{
+    // enough batches to balance the load, but large enough to make handing them out cheap
+    const size_t min_batch_size = 64 * 1024;
+    const size_t max_batch_size = 1024 * 1024;
+
+    return std::min(std::max(length / (threads * 16), min_batch_size), max_batch_size);
+}
+
+// Calls handler(context, offset) for every line of buffer between begin and end that is not blank,
+// where context is a buffer_context holding a copy of the line in scratch, and offset is the offset
+// of the line in buffer. Stops early if stop becomes true.
+template<typename Handler>
+void parse_lines(const char* buffer, size_t begin, size_t end, std::vector<char>& scratch, Handler& handler, const std::atomic<bool>& stop)
+{
+    const char* p = buffer + begin;
+    const char* const last = buffer + end;
+    while ((p != last) && !stop.load(std::memory_order_relaxed))
+    {
+        const char* const line_end = find_byte(p, last, '\n');
+        const char* const first = find_non_whitespace(p, line_end);
+        if (first != line_end)
+        {
+            scratch.assign(first, line_end); // only allocates when a line is longer than all the previous ones
+            buffer_context context(&scratch[0], scratch.size());
+            handler(context, static_cast<size_t>(first - buffer));
+        }
+
+        p = (line_end != last) ? line_end + 1 : last;
+    }
+}
+
+// runs work() on the calling thread and on threads - 1 more threads, and waits for all of them
+template<typename Work>
+void run_on_threads(size_t threads, Work work)
+{
+    std::vector<std::thread> workers;
+    try
+    {
+        for (size_t i = 1; i < threads; i++)
+        {
+            workers.emplace_back(std::ref(work));
+        }
+    }
+    catch (...)
+    {
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+        throw;
+    }
+
+    work();
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+}
+
+} // namespace detail
+
+// Parses newline-delimited JSON (one message per line) on several threads: the input is split
+// into batches of whole lines, and handler(context, offset) is called for every line that is not
+// blank, where context is a buffer_context holding a copy of the line, and offset is the offset of
+// the line in buffer. The handler is called concurrently from all the threads, in no particular
+// order. The first exception it throws stops all the threads, and is rethrown by parse_ndjson.
+// threads == 0 means std::thread::hardware_concurrency(), batch_size == 0 means automatic.
+template<typename Handler>
+void parse_ndjson(const char* buffer, size_t length, Handler handler, size_t threads = 0, size_t batch_size = 0)
+{
+    if (threads == 0)
+    {
+        threads = detail::default_thread_count();
+    }
+    if (batch_size == 0)
+    {
+        batch_size = detail::default_batch_size(length, threads);
+    }
+
+    const std::vector<size_t> boundaries = detail::split_lines(buffer, length, batch_size);
+    const size_t batch_count = boundaries.size() - 1;
+
+    std::atomic<size_t> next_batch(0);
+    std::atomic<bool> stop(false);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    detail::run_on_threads(std::min(threads, batch_count), [&]
+    {
+        std::vector<char> scratch;
+        size_t batch;
+        while (!stop.load(std::memory_order_relaxed) && ((batch = next_batch++) < batch_count))
+        {
+            try
+            {
+                detail::parse_lines(buffer, boundaries[batch], boundaries[batch + 1], scratch, handler, stop);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                stop = true;
+            }
+        }
+    });
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// Same as parse_ndjson, but handler(context, offset) returns a result for every line, and
+// consumer(result) is called with the results on the calling thread, in the order of the lines.
+// If the handler throws, the results of the lines before the failed one are consumed, and then
+// the exception is rethrown. The threads only get a few batches ahead of the consumer, so the
+// results never pile up.
+template<typename Handler, typename Consumer>
+void parse_ndjson_ordered(const char* buffer, size_t length, Handler handler, Consumer consumer, size_t threads = 0, size_t batch_size = 0)
+{
+    typedef typename std::decay<decltype(handler(std::declval<buffer_context&>(), size_t()))>::type result_type;
+
+    struct batch
+    {
+        std::vector<result_type> results;
+        std::exception_ptr error;
+        std::promise<void> parsed;
+        std::promise<void> consumed; // lets the batch max_batches_ahead positions later be parsed
+        std::future<void> parsed_future;
+        std::future<void> consumed_future;
+
+        batch() :
+            parsed_future(parsed.get_future()),
+            consumed_future(consumed.get_future())
+        {
+        }
+    };
+
+    if (threads == 0)
+    {
+        threads = detail::default_thread_count();
+    }
+    if (batch_size == 0)
+    {
+        batch_size = detail::default_batch_size(length, threads);
+    }
+
+    const std::vector<size_t> boundaries = detail::split_lines(buffer, length, batch_size);
+    const size_t batch_count = boundaries.size() - 1;
+    const size_t max_batches_ahead = 4 * threads;
+
+    std::vector<batch> batches(batch_count);
+    std::atomic<size_t> next_batch(0);
+    std::atomic<bool> stop(false);
+
+    const auto work = [&]
+    {
+        std::vector<char> scratch;
+        size_t index;
+        while (!stop.load(std::memory_order_relaxed) && ((index = next_batch++) < batch_count))
+        {
+            if (index >= max_batches_ahead)
+            {
+                batches[index - max_batches_ahead].consumed_future.wait();
+                if (stop)
+                {
+                    return;
+                }
+            }
+
+            batch& current = batches[index];
+            auto collect = [&](buffer_context& context, size_t offset) { current.results.push_back(handler(context, offset)); };
+            try
+            {
+                detail::parse_lines(buffer, boundaries[index], boundaries[index + 1], scratch, collect, stop);
+            }
+            catch (...)
+            {
+                current.error = std::current_exception();
+            }
+            current.parsed.set_value();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t consumed = 0; // the number of batches whose consumed promise is fulfilled
+
+    const auto stop_workers = [&]
+    {
+        stop = true;
+        for (; consumed < batch_count; consumed++) // wakes up the waiting threads
+        {
+            batches[consumed].consumed.set_value();
+        }
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+    };
+
+    try
+    {
+        for (size_t i = 0; i < std::min(threads, batch_count); i++)
+        {
+            workers.emplace_back(work);
+        }
+
+        while (consumed < batch_count)
+        {
+            batch& current = batches[consumed];
+            current.parsed_future.wait();
+
+            for (size_t i = 0; i < current.results.size(); i++)
+            {
+                consumer(current.results[i]);
+            }
+            if (current.error)
+            {
+                std::rethrow_exception(current.error);
+            }
+            std::vector<result_type>().swap(current.results);
+
+            current.consumed.set_value();
+            consumed++;
+        }
+    }
+    catch (...)
+    {
+        stop_workers();
+        throw;
+    }
+
+    stop_workers();
+}
+
+} // namespace minijson
+
+#endif // MINIJSON_NDJSON_H
@@ -2,18 +2,24 @@
 #define MINIJSON_READER_H
 
 #include <cstdlib>
+#include <cstddef>
 #include <cctype>
 #include <stdint.h>
 #include <climits>
 #include <cstring>
 #include <cerrno>
+#include <cfloat>
+#include <clocale>
+
+#include <algorithm>
+#include <limits>
 
 #include <vector>
-#include <list>
 #include <string>
 #include <utility>
 
 #include <stdexcept>
+#include <new>
 #include <istream>
 
 #define MJR_CPP11_SUPPORTED __cplusplus > 199711L || _MSC_VER >= 1800
@@ -32,6 +38,44 @@
 #define MJR_NESTING_LIMIT 32
 #endif
 
+// The scanning kernels use AVX2 or SSE2 when the compiler targets them,
+// and portable 8-byte SWAR code otherwise. Define MJR_DISABLE_SIMD to force the latter.
+#ifndef MJR_DISABLE_SIMD
+#if defined(__AVX2__)
+#define MJR_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MJR_USE_SSE2
+#include <emmintrin.h>
+#endif
+#endif // MJR_DISABLE_SIMD
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// the integer parser loads 8 digits at a time when the byte order is known to be little-endian
+#if (defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)) || defined(_MSC_VER)
+#define MJR_LITTLE_ENDIAN
+#endif
+
+// mmap_file_context is only available on POSIX systems
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#define MJR_MMAP_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// parse_events is a coroutine, and is only available in C++20 mode
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+#define MJR_COROUTINES_SUPPORTED
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#endif
+
 #define MJR_STRINGIFY(S) MJR_STRINGIFY_HELPER(S)
 #define MJR_STRINGIFY_HELPER(S) #S
 
@@ -48,6 +92,123 @@ enum value_type
     Null
 };
 
+class parse_error : public std::exception
+{
+public:
+
+    enum error_reason
+    {
+        UNKNOWN,
+        EXPECTED_OPENING_QUOTE,
+        EXPECTED_UTF16_LOW_SURROGATE,
+        INVALID_ESCAPE_SEQUENCE,
+        INVALID_UTF16_CHARACTER,
+        EXPECTED_CLOSING_QUOTE,
+        INVALID_VALUE,
+        UNTERMINATED_VALUE,
+        EXPECTED_OPENING_BRACKET,
+        EXPECTED_COLON,
+        EXPECTED_COMMA_OR_CLOSING_BRACKET,
+        NESTED_OBJECT_OR_ARRAY_NOT_PARSED,
+        EXCEEDED_NESTING_LIMIT
+    };
+
+private:
+
+    size_t m_offset;
+    error_reason m_reason;
+
+    template<typename Context>
+    static size_t get_offset(const Context& context)
+    {
+        const size_t read_offset = context.read_offset();
+
+        return (read_offset != 0) ? (read_offset - 1) : 0;
+    }
+
+public:
+
+    template<typename Context>
+    explicit parse_error(const Context& context, error_reason reason) :
+        m_offset(get_offset(context)),
+        m_reason(reason)
+    {
+    }
+
+    explicit parse_error(error_reason reason, size_t offset) :
+        m_offset(offset),
+        m_reason(reason)
+    {
+    }
+
+    size_t offset() const
+    {
+        return m_offset;
+    }
+
+    error_reason reason() const
+    {
+        return m_reason;
+    }
+
+    const char* what() const throw()
+    {
+        switch (m_reason)
+        {
+        case UNKNOWN:                           return "Unknown parse error";
+        case EXPECTED_OPENING_QUOTE:            return "Expected opening quote";
+        case EXPECTED_UTF16_LOW_SURROGATE:      return "Expected UTF-16 low surrogate";
+        case INVALID_ESCAPE_SEQUENCE:           return "Invalid escape sequence";
+        case INVALID_UTF16_CHARACTER:           return "Invalid UTF-16 character";
+        case EXPECTED_CLOSING_QUOTE:            return "Expected closing quote";
+        case INVALID_VALUE:                     return "Invalid value";
+        case UNTERMINATED_VALUE:                return "Unterminated value";
+        case EXPECTED_OPENING_BRACKET:          return "Expected opening bracket";
+        case EXPECTED_COLON:                    return "Expected colon";
+        case EXPECTED_COMMA_OR_CLOSING_BRACKET: return "Expected comma or closing bracket";
+        case NESTED_OBJECT_OR_ARRAY_NOT_PARSED: return "Nested object or array not parsed";
+        case EXCEEDED_NESTING_LIMIT:            return "Exceeded nesting limit (" MJR_STRINGIFY(MJR_NESTING_LIMIT) ")";
+        }
+
+        return ""; // to suppress compiler warnings -- LCOV_EXCL_LINE
+    }
+}; // class parse_error
+
+// The outcome of try_parse_object and try_parse_array, which report errors through their return value
+// instead of throwing parse_error
+class parse_status
+{
+private:
+
+    bool m_failed;
+    parse_error m_error;
+
+public:
+
+    parse_status() :
+        m_failed(false),
+        m_error(parse_error::UNKNOWN, 0)
+    {
+    }
+
+    explicit parse_status(const parse_error& error) :
+        m_failed(true),
+        m_error(error)
+    {
+    }
+
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+    // meaningful only if failed() is true
+    const parse_error& error() const
+    {
+        return m_error;
+    }
+}; // class parse_status
+
 namespace detail
 {
 
@@ -66,6 +227,95 @@ public:
     }
 }; // class noncopyable
 
+inline unsigned int count_trailing_zeros(uint32_t mask) // mask must not be zero
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+inline unsigned int count_trailing_zeros(uint64_t mask) // mask must not be zero
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index;
+#elif defined(_MSC_VER)
+    const uint32_t low = static_cast<uint32_t>(mask);
+    return (low != 0) ? count_trailing_zeros(low) : 32 + count_trailing_zeros(static_cast<uint32_t>(mask >> 32));
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+inline unsigned int count_leading_zeros(uint64_t mask) // mask must not be zero
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return 63 - index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    const uint32_t high = static_cast<uint32_t>(mask >> 32);
+    if (high != 0)
+    {
+        _BitScanReverse(&index, high);
+        return 31 - index;
+    }
+    _BitScanReverse(&index, static_cast<uint32_t>(mask));
+    return 63 - index;
+#else
+    return __builtin_clzll(mask);
+#endif
+}
+
+inline unsigned int count_ones(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    return static_cast<unsigned int>(__popcnt64(mask));
+#elif defined(_MSC_VER)
+    return __popcnt(static_cast<uint32_t>(mask)) + __popcnt(static_cast<uint32_t>(mask >> 32));
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+inline uint64_t load_uint64(const char* data)
+{
+    uint64_t result;
+    std::memcpy(&result, data, sizeof(result)); // unaligned load
+
+    return result;
+}
+
+static const uint64_t SWAR_ONES = 0x0101010101010101ULL;
+static const uint64_t SWAR_HIGH_BITS = 0x8080808080808080ULL;
+
+// non-zero iff any byte of word is less than n (n <= 128)
+inline uint64_t swar_has_less(uint64_t word, unsigned char n)
+{
+    return (word - SWAR_ONES * n) & ~word & SWAR_HIGH_BITS;
+}
+
+// non-zero iff any byte of word is equal to c
+inline uint64_t swar_has_byte(uint64_t word, unsigned char c)
+{
+    return swar_has_less(word ^ (SWAR_ONES * c), 1);
+}
+
+// sets the high bit of every byte of word that is equal to c, and clears all other bits
+inline uint64_t swar_equal_bytes(uint64_t word, unsigned char c)
+{
+    const uint64_t x = word ^ (SWAR_ONES * c);
+    const uint64_t low_bits = ~SWAR_HIGH_BITS;
+
+    return ~(((x & low_bits) + low_bits) | x) & SWAR_HIGH_BITS;
+}
+
 class context_base : noncopyable
 {
 public:
@@ -81,6 +331,7 @@ private:
 
     context_nested_status m_nested_status;
     size_t m_nesting_level;
+    parse_status m_status;
 
 public:
 
@@ -90,6 +341,17 @@ public:
     {
     }
 
+    // the error that made parsing fail, so that it can be reported past the handlers of the enclosing objects and arrays
+    const parse_status& status() const
+    {
+        return m_status;
+    }
+
+    void set_status(const parse_status& status)
+    {
+        m_status = status;
+    }
+
     char nested_status() const
     {
         return m_nested_status;
@@ -120,645 +382,2989 @@ public:
     }
 }; // class context_base
 
-class buffer_context_base : public context_base
+// Contexts deriving from this class expose the unread part of their input as a contiguous
+// window, which allows the scanning kernels below to process it in bulk instead of calling
+// read() and write() once per byte. The derived class must provide:
+// - const char* read_window() const: the unread input
+// - size_t read_window_size() const: the number of bytes available in the window
+// - void consume(size_t size): marks the first size bytes of the window as read
+// - void write(const char* data, size_t size): same as calling write() for every byte
+class windowed_context
 {
-protected:
+}; // class windowed_context
 
-    const char* m_read_buffer;
-    char* m_write_buffer;
-    size_t m_length;
-    size_t m_read_offset;
-    size_t m_write_offset;
-    const char* m_current_write_buffer;
+// bit i of the result is the XOR of bits 0 to i of bits
+inline uint64_t prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+
+    return bits;
+}
 
-    explicit buffer_context_base(const char* read_buffer, char* write_buffer, size_t length) :
-        m_read_buffer(read_buffer),
-        m_write_buffer(write_buffer),
-        m_length(length),
-        m_read_offset(0),
-        m_write_offset(0),
-        m_current_write_buffer(NULL)
+// the bytes of a block escaped by a backslash: a backslash escapes the next byte, unless the
+// backslash is escaped itself (escaped_carry is 1 if the first byte of the block is escaped,
+// and is updated for the next block)
+inline uint64_t find_escaped(uint64_t backslashes, uint64_t& escaped_carry)
+{
+    uint64_t escaped = escaped_carry;
+    backslashes &= ~escaped;
+    escaped_carry = 0;
+    while (backslashes != 0)
     {
-        new_write_buffer();
+        const uint64_t backslash = backslashes & (~backslashes + 1);
+        const uint64_t next = backslash << 1;
+        if (next == 0)
+        {
+            escaped_carry = 1;
+        }
+        escaped |= next;
+        backslashes &= ~(backslash | next);
     }
 
-public:
-
-    value_type toplevel_type()
-    {
-        if (strlen(m_read_buffer) == 0) {
-            return Null;
-        }
+    return escaped;
+}
 
-        int i;
-        for (i = 0; i < m_length; i++) {
-            if (!isspace(m_read_buffer[i])) {
-                break;
-            }
-        }
+// bitmasks of the bytes of a 64-byte block the skipper looks at
+struct bracket_classes
+{
+    uint64_t quotes;
+    uint64_t backslashes;
+    uint64_t opening; // {[
+    uint64_t closing; // }]
+};
 
-        switch (m_read_buffer[i]) {
-            case '[':
-                return Array;
-            case '{':
-                return Object;
-            default:
-                return Null;
-        }
-    }
+inline bracket_classes classify_brackets(const char* block)
+{
+    bracket_classes result = { 0, 0, 0, 0 };
 
-    char read()
+#if defined(MJR_USE_AVX2)
+    for (size_t i = 0; i < 64; i += 32)
     {
-        if (m_read_offset >= m_length)
-        {
-            return 0;
-        }
-
-        return m_read_buffer[m_read_offset++];
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        const __m256i lowered = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20)); // maps [ and ] to { and }
+
+        result.quotes |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))))) << i;
+        result.backslashes |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))))) << i;
+        result.opening |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(lowered, _mm256_set1_epi8('{'))))) << i;
+        result.closing |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(lowered, _mm256_set1_epi8('}'))))) << i;
     }
-
-    size_t read_offset() const
+#elif defined(MJR_USE_SSE2)
+    for (size_t i = 0; i < 64; i += 16)
     {
-        return m_read_offset;
-    }
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        const __m128i lowered = _mm_or_si128(chunk, _mm_set1_epi8(0x20)); // maps [ and ] to { and }
 
-    size_t length() const
-    {
-        return m_length;
+        result.quotes |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')))) << i;
+        result.backslashes |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')))) << i;
+        result.opening |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lowered, _mm_set1_epi8('{')))) << i;
+        result.closing |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lowered, _mm_set1_epi8('}')))) << i;
     }
-
-    void new_write_buffer()
+#else
+    for (size_t i = 0; i < 64; i++)
     {
-        m_current_write_buffer = m_write_buffer + m_write_offset;
-    }
+        const uint64_t bit = static_cast<uint64_t>(1) << i;
 
-    void write(char c)
-    {
-        if (m_write_offset >= m_read_offset)
+        switch (block[i])
         {
-            throw std::runtime_error("Invalid write call, please file a bug report");
+        case '"':
+            result.quotes |= bit;
+            break;
+        case '\\':
+            result.backslashes |= bit;
+            break;
+        case '{': case '[':
+            result.opening |= bit;
+            break;
+        case '}': case ']':
+            result.closing |= bit;
+            break;
         }
-
-        m_write_buffer[m_write_offset++] = c;
     }
+#endif
 
-    const char* write_buffer() const
-    {
-        return m_current_write_buffer;
-    }
-}; // class buffer_context_base
+    return result;
+}
 
-} // namespace detail
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
 
-class buffer_context MJR_FINAL : public detail::buffer_context_base
+// Contexts deriving from this class can be given a structural_index of their input, which lets the
+// parser jump from token to token. In addition to the members of windowed_context, the derived
+// class must provide:
+// - const structural_index* index() const: the index, or NULL if there is none
+// - size_t next_token(size_t offset): the number of the first token at or after offset, where
+//   offset never decreases from one call to the next
+// - size_t read_offset() const and size_t length() const
+class indexed_context : public windowed_context
 {
-public:
+}; // class indexed_context
 
-    explicit buffer_context(char* buffer, size_t length) :
-        detail::buffer_context_base(buffer, buffer, length)
-    {
-    }
-}; // class buffer_context
+// bitmasks of the bytes of a 64-byte block the structural index looks at
+struct structural_classes
+{
+    uint64_t quotes;
+    uint64_t backslashes;
+    uint64_t structural; // {}[]:,
+    uint64_t whitespace; // the bytes isspace() accepts in the C locale
+    uint64_t nul;
+};
 
-class const_buffer_context MJR_FINAL : public detail::buffer_context_base
+inline structural_classes classify_structurals(const char* block)
 {
-public:
+    structural_classes result = { 0, 0, 0, 0, 0 };
 
-    explicit const_buffer_context(const char* buffer, size_t length) :
-        detail::buffer_context_base(buffer, new char[length], length) // don't worry about leaks, buffer_context_base can't throw
+#if defined(MJR_USE_AVX2)
+    for (size_t i = 0; i < 64; i += 32)
     {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        const __m256i lowered = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20)); // maps [ and ] to { and }
+        const __m256i control = _mm256_sub_epi8(chunk, _mm256_set1_epi8('\t')); // \t to \r become 0 to 4
+        const __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lowered, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lowered, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(','))));
+        const __m256i whitespace = _mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)), control)); // control <= 4
+
+        result.quotes |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))))) << i;
+        result.backslashes |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))))) << i;
+        result.structural |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(structural))) << i;
+        result.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))) << i;
+        result.nul |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_setzero_si256())))) << i;
     }
-
-    ~const_buffer_context()
+#elif defined(MJR_USE_SSE2)
+    for (size_t i = 0; i < 64; i += 16)
     {
-        delete[] m_write_buffer;
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        const __m128i lowered = _mm_or_si128(chunk, _mm_set1_epi8(0x20)); // maps [ and ] to { and }
+        const __m128i control = _mm_sub_epi8(chunk, _mm_set1_epi8('\t')); // \t to \r become 0 to 4
+        const __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lowered, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lowered, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))));
+        const __m128i whitespace = _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+            _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control)); // control <= 4
+
+        result.quotes |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')))) << i;
+        result.backslashes |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')))) << i;
+        result.structural |= static_cast<uint64_t>(_mm_movemask_epi8(structural)) << i;
+        result.whitespace |= static_cast<uint64_t>(_mm_movemask_epi8(whitespace)) << i;
+        result.nul |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_setzero_si128()))) << i;
     }
-}; // class const_buffer_context
+#else
+    for (size_t i = 0; i < 64; i++)
+    {
+        const uint64_t bit = static_cast<uint64_t>(1) << i;
 
-class istream_context MJR_FINAL : public detail::context_base
-{
-private:
+        switch (block[i])
+        {
+        case '"':
+            result.quotes |= bit;
+            break;
+        case '\\':
+            result.backslashes |= bit;
+            break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            result.structural |= bit;
+            break;
+        case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+            result.whitespace |= bit;
+            break;
+        case 0:
+            result.nul |= bit;
+            break;
+        }
+    }
+#endif
 
-    std::istream& m_stream;
-    size_t m_read_offset;
-    std::list<std::vector<char> > m_write_buffers;
+    return result;
+}
+
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
+
+} // namespace detail
+
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+
+// An index of the tokens of a JSON message, built in a single vectorized pass: the offsets of
+// the structural characters ({}[]:,) outside strings, of the opening quotes of strings, of the
+// first bytes of the other values (numbers, literals, and anything else that is neither a string
+// nor whitespace), and of the null characters outside strings. Every opening bracket also knows
+// the token of the matching closing one.
+// Given to a buffer context with set_index(), it lets the parser skip ignored objects and arrays
+// in constant time, and copy numbers and literals without looking at every byte. The index is
+// only a hint: the parser still reads the tokens themselves, and parses invalid messages exactly
+// as it would without an index. The index can be reused to parse the same buffer again, except
+// with buffer_context, which overwrites the strings it decodes.
+// The messages must be shorter than 4 GiB.
+class structural_index : detail::noncopyable
+{
+private:
+
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_closing; // the matching closing bracket of opening brackets, 0 otherwise
 
 public:
 
-    explicit istream_context(std::istream& stream) :
-        m_stream(stream),
-        m_read_offset(0)
+    structural_index()
     {
-        new_write_buffer();
     }
 
-    char read()
+    // may throw std::length_error if length is 4 GiB or more, and std::bad_alloc
+    explicit structural_index(const char* buffer, size_t length)
     {
-        const char c = m_stream.get();
+        build(buffer, length);
+    }
 
-        if (m_stream)
+    // indexes another message, reusing the memory of the previous one
+    void build(const char* buffer, size_t length)
+    {
+        if (length > static_cast<size_t>(static_cast<uint32_t>(-1)))
         {
-            m_read_offset++;
-
-            return c;
+            throw std::length_error("The message is too long to be indexed");
         }
-        else
+
+        m_offsets.resize(std::max(m_offsets.capacity(), length / 4 + 64));
+        m_closing.assign(m_offsets.size(), 0);
+        size_t count = 0;
+        std::vector<uint32_t> open_brackets;
+
+        uint64_t escaped_carry = 0;
+        uint64_t in_string_carry = 0; // all ones if the next block starts inside a string
+        uint64_t boundary_carry = 1; // the first value of the message starts a token
+
+        for (size_t block_offset = 0; block_offset < length; block_offset += 64)
         {
-            return 0;
+            const char* block = buffer + block_offset;
+            char padded[64];
+            uint64_t valid = ~static_cast<uint64_t>(0);
+            if (length - block_offset < 64)
+            {
+                std::memset(padded, ' ', sizeof(padded));
+                std::memcpy(padded, block, length - block_offset);
+                block = padded;
+                valid = (static_cast<uint64_t>(1) << (length - block_offset)) - 1;
+            }
+
+            const detail::structural_classes classes = detail::classify_structurals(block);
+            const uint64_t escaped = detail::find_escaped(classes.backslashes, escaped_carry);
+            const uint64_t quotes = classes.quotes & ~escaped;
+            const uint64_t in_string = detail::prefix_xor(quotes) ^ in_string_carry; // opening quotes included
+            const uint64_t outside = ~in_string;
+
+            const uint64_t boundaries = classes.whitespace | classes.structural | quotes | classes.nul;
+            const uint64_t value_starts =
+                ~boundaries & ((boundaries << 1) | boundary_carry); // the first bytes of the unquoted values
+            uint64_t tokens = (((classes.structural | classes.nul | value_starts) & outside) | (quotes & in_string)) & valid;
+
+            in_string_carry = static_cast<uint64_t>(0) - (in_string >> 63);
+            boundary_carry = boundaries >> 63;
+
+            if (m_offsets.size() - count < 64)
+            {
+                m_offsets.resize(2 * m_offsets.size());
+                m_closing.resize(m_offsets.size(), 0);
+            }
+
+            for (; tokens != 0; tokens &= tokens - 1)
+            {
+                const size_t position = detail::count_trailing_zeros(tokens);
+                const size_t offset = block_offset + position;
+                m_offsets[count] = static_cast<uint32_t>(offset);
+
+                // like the skipper, brackets escaped outside strings (which is invalid) aren't paired
+                const char c = ((escaped >> position) & 1) ? 0 : static_cast<char>(buffer[offset] | 0x20); // maps [ and ] to { and }
+                if (c == '{')
+                {
+                    open_brackets.push_back(static_cast<uint32_t>(count));
+                }
+                else if ((c == '}') && !open_brackets.empty())
+                {
+                    m_closing[open_brackets.back()] = static_cast<uint32_t>(count);
+                    open_brackets.pop_back();
+                }
+                count++;
+            }
         }
+
+        m_offsets.resize(count);
+        m_closing.resize(count);
     }
 
-    size_t read_offset() const
+    // the number of tokens
+    size_t size() const
     {
-        return m_read_offset;
+        return m_offsets.size();
     }
 
-    void new_write_buffer()
+    // the offset of the token in the message
+    size_t offset(size_t token) const
     {
-        m_write_buffers.push_back(std::vector<char>());
+        return m_offsets[token];
     }
 
-    void write(char c)
+    // the token of the bracket that closes the object or array opened by token,
+    // or 0 if token is not an opening bracket, or if it is never closed
+    size_t closing(size_t token) const
     {
-        m_write_buffers.back().push_back(c);
+        return m_closing[token];
     }
 
-    // This method to retrieve the address of the write buffer MUST be called
-    // AFTER all the calls to write() for the current write buffer have been performed
-    const char* write_buffer() const
+    // the first token at or after offset (or size() if there is none), searching from token from on
+    size_t next(size_t offset, size_t from = 0) const
     {
-        return !m_write_buffers.back().empty() ? &m_write_buffers.back()[0] : NULL;
+        if ((from >= m_offsets.size()) || (m_offsets[from] >= offset))
+        {
+            return from;
+        }
+        else if ((from + 1 == m_offsets.size()) || (m_offsets[from + 1] >= offset)) // the usual case while parsing
+        {
+            return from + 1;
+        }
+
+        return std::lower_bound(m_offsets.begin() + from + 2, m_offsets.end(), offset) - m_offsets.begin();
     }
-}; // class istream_context
+}; // class structural_index
 
-class parse_error : public std::exception
-{
-public:
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
 
-    enum error_reason
-    {
-        UNKNOWN,
-        EXPECTED_OPENING_QUOTE,
-        EXPECTED_UTF16_LOW_SURROGATE,
-        INVALID_ESCAPE_SEQUENCE,
-        INVALID_UTF16_CHARACTER,
-        EXPECTED_CLOSING_QUOTE,
-        INVALID_VALUE,
-        UNTERMINATED_VALUE,
-        EXPECTED_OPENING_BRACKET,
-        EXPECTED_COLON,
-        EXPECTED_COMMA_OR_CLOSING_BRACKET,
-        NESTED_OBJECT_OR_ARRAY_NOT_PARSED,
-        EXCEEDED_NESTING_LIMIT
-    };
+namespace detail
+{
 
-private:
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+class buffer_context_base : public context_base, public indexed_context
+#else
+class buffer_context_base : public context_base, public windowed_context
+#endif
+{
+protected:
 
-    size_t m_offset;
-    error_reason m_reason;
+    const char* m_read_buffer;
+    char* m_write_buffer;
+    size_t m_length;
+    size_t m_read_offset;
+    size_t m_write_offset;
+    const char* m_current_write_buffer;
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+    const structural_index* m_index;
+    size_t m_next_token;
+#endif
 
-    template<typename Context>
-    static size_t get_offset(const Context& context)
+    explicit buffer_context_base(const char* read_buffer, char* write_buffer, size_t length) :
+        m_read_buffer(read_buffer),
+        m_write_buffer(write_buffer),
+        m_length(length),
+        m_read_offset(0),
+        m_write_offset(0),
+        m_current_write_buffer(NULL)
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+        , m_index(NULL),
+        m_next_token(0)
+#endif
     {
-        const size_t read_offset = context.read_offset();
-
-        return (read_offset != 0) ? (read_offset - 1) : 0;
+        new_write_buffer();
     }
 
 public:
 
-    template<typename Context>
-    explicit parse_error(const Context& context, error_reason reason) :
-        m_offset(get_offset(context)),
-        m_reason(reason)
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+    // index must have been built from the same buffer, and must outlive the context
+    void set_index(const structural_index& index)
     {
+        m_index = &index;
+        m_next_token = 0;
     }
 
-    size_t offset() const
+    const structural_index* index() const
     {
-        return m_offset;
+        return m_index;
     }
 
-    error_reason reason() const
+    size_t next_token(size_t offset)
     {
-        return m_reason;
+        m_next_token = m_index->next(offset, m_next_token);
+
+        return m_next_token;
     }
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
 
-    const char* what() const throw()
+    value_type toplevel_type()
     {
-        switch (m_reason)
-        {
-        case UNKNOWN:                           return "Unknown parse error";
-        case EXPECTED_OPENING_QUOTE:            return "Expected opening quote";
-        case EXPECTED_UTF16_LOW_SURROGATE:      return "Expected UTF-16 low surrogate";
-        case INVALID_ESCAPE_SEQUENCE:           return "Invalid escape sequence";
-        case INVALID_UTF16_CHARACTER:           return "Invalid UTF-16 character";
-        case EXPECTED_CLOSING_QUOTE:            return "Expected closing quote";
-        case INVALID_VALUE:                     return "Invalid value";
-        case UNTERMINATED_VALUE:                return "Unterminated value";
-        case EXPECTED_OPENING_BRACKET:          return "Expected opening bracket";
-        case EXPECTED_COLON:                    return "Expected colon";
-        case EXPECTED_COMMA_OR_CLOSING_BRACKET: return "Expected comma or closing bracket";
-        case NESTED_OBJECT_OR_ARRAY_NOT_PARSED: return "Nested object or array not parsed";
-        case EXCEEDED_NESTING_LIMIT:            return "Exceeded nesting limit (" MJR_STRINGIFY(MJR_NESTING_LIMIT) ")";
+        size_t i;
+        for (i = 0; i < m_length; i++) {
+            if (!isspace(m_read_buffer[i])) {
+                break;
+            }
         }
 
-        return ""; // to suppress compiler warnings -- LCOV_EXCL_LINE
+        if (i == m_length) {
+            return Null;
+        }
+
+        switch (m_read_buffer[i]) {
+            case '[':
+                return Array;
+            case '{':
+                return Object;
+            default:
+                return Null;
+        }
     }
-}; // class parse_error
 
-namespace detail
-{
+    char read()
+    {
+        if (m_read_offset >= m_length)
+        {
+            return 0;
+        }
 
-struct utf8_char
-{
-    uint8_t bytes[4];
+        return m_read_buffer[m_read_offset++];
+    }
 
-    utf8_char()
+    size_t read_offset() const
     {
-        // wanted use value-initialization, but couldn't because of a weird VS2013 warning
-        std::fill_n(bytes, sizeof(bytes), 0);
+        return m_read_offset;
     }
 
-    explicit utf8_char(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
+    size_t length() const
     {
-        bytes[0] = b0;
-        bytes[1] = b1;
-        bytes[2] = b2;
-        bytes[3] = b3;
+        return m_length;
     }
 
-    uint8_t& operator[](size_t i)
+    const char* read_window() const
     {
-        return bytes[i];
+        return m_read_buffer + m_read_offset;
     }
 
-    const uint8_t& operator[](size_t i) const
+    size_t read_window_size() const
     {
-        return bytes[i];
+        return m_length - m_read_offset;
     }
 
-    bool operator==(const utf8_char& other) const
+    void consume(size_t size)
     {
-        return std::equal(bytes, bytes + sizeof(bytes), other.bytes);
+        m_read_offset += size;
     }
 
-    bool operator!=(const utf8_char& other) const
+    void new_write_buffer()
     {
-        return !operator==(other);
+        m_current_write_buffer = m_write_buffer + m_write_offset;
     }
-}; // struct utf8_char
-
-// this exception is not to be propagated outside minijson
-struct encoding_error
-{
-};
-
-inline uint32_t utf16_to_utf32(uint16_t high, uint16_t low)
-{
-    uint32_t result;
 
-    if (high <= 0xD7FF || high >= 0xE000)
+    void write(char c)
     {
-        if (low != 0)
+        if (m_write_offset >= m_read_offset)
         {
-            // since the high code unit is not a surrogate, the low code unit should be zero
-            throw encoding_error();
+            throw std::runtime_error("Invalid write call, please file a bug report");
         }
 
-        result = high;
+        m_write_buffer[m_write_offset++] = c;
     }
-    else
+
+    void write(const char* data, size_t size)
     {
-        if (high > 0xDBFF) // we already know high >= 0xD800
+        if (m_write_offset + size > m_read_offset)
         {
-            // the high surrogate is not within the expected range
-            throw encoding_error();
+            throw std::runtime_error("Invalid write call, please file a bug report");
         }
 
-        if (low < 0xDC00 || low > 0xDFFF)
+        if (data != m_write_buffer + m_write_offset) // buffer_context writes in place
         {
-            // the low surrogate is not within the expected range
-            throw encoding_error();
+            std::memmove(m_write_buffer + m_write_offset, data, size);
         }
+        m_write_offset += size;
+    }
 
-        high -= 0xD800;
-        low -= 0xDC00;
-        result = 0x010000 + ((high << 10) | low);
+    const char* write_buffer() const
+    {
+        return m_current_write_buffer;
     }
+}; // class buffer_context_base
 
-    return result;
-}
+} // namespace detail
 
-inline utf8_char utf32_to_utf8(uint32_t utf32_char)
+class buffer_context MJR_FINAL : public detail::buffer_context_base
 {
-    utf8_char result;
+public:
 
-    if      (utf32_char <= 0x00007F)
+    explicit buffer_context(char* buffer, size_t length) :
+        detail::buffer_context_base(buffer, buffer, length)
     {
-        result[0] = utf32_char;
     }
-    else if (utf32_char <= 0x0007FF)
+}; // class buffer_context
+
+class const_buffer_context MJR_FINAL : public detail::buffer_context_base
+{
+public:
+
+    explicit const_buffer_context(const char* buffer, size_t length) :
+        detail::buffer_context_base(buffer, new char[length], length) // don't worry about leaks, buffer_context_base can't throw
     {
-        result[0] = 0xC0 | ((utf32_char & (0x1F <<  6)) >>  6);
-        result[1] = 0x80 | ((utf32_char & (0x3F      ))      );
     }
-    else if (utf32_char <= 0x00FFFF)
+
+    ~const_buffer_context()
     {
-        result[0] = 0xE0 | ((utf32_char & (0x0F << 12)) >> 12);
-        result[1] = 0x80 | ((utf32_char & (0x3F <<  6)) >>  6);
-        result[2] = 0x80 | ((utf32_char & (0x3F      ))      );
-    }
-    else if (utf32_char <= 0x1FFFFF)
-    {
-        result[0] = 0xF0 | ((utf32_char & (0x07 << 18)) >> 18);
-        result[1] = 0x80 | ((utf32_char & (0x3F << 12)) >> 12);
-        result[2] = 0x80 | ((utf32_char & (0x3F <<  6)) >>  6);
-        result[3] = 0x80 | ((utf32_char & (0x3F      ))      );
-    }
-    else
-    {
-        // invalid code unit
-        throw encoding_error();
+        delete[] m_write_buffer;
     }
+}; // class const_buffer_context
 
-    return result;
-}
+#ifdef MJR_MMAP_SUPPORTED
 
-inline utf8_char utf16_to_utf8(uint16_t high, uint16_t low)
+namespace detail
 {
-    return utf32_to_utf8(utf16_to_utf32(high, low));
-}
 
-// this exception is not to be propagated outside minijson
-struct number_parse_error
+// A read-only mapping of a whole file, advised for sequential access
+class file_mapping : noncopyable
 {
-};
+private:
 
-inline long parse_long(const char* str, int base = 10)
-{
-    if ((str == NULL) || (*str == 0) || isspace(str[0])) // we don't accept empty strings or strings with leading spaces
+    const char* m_data;
+    size_t m_size;
+
+public:
+
+    explicit file_mapping(const char* path) :
+        m_data(NULL),
+        m_size(0)
     {
-        throw number_parse_error();
-    }
+        const int fd = ::open(path, O_RDONLY);
+        if (fd == -1)
+        {
+            throw std::runtime_error(std::string("Cannot open ") + path + ": " + std::strerror(errno));
+        }
 
-    int saved_errno = errno; // save errno
-    errno = 0; // reset errno
+        struct stat file_status;
+        if (::fstat(fd, &file_status) == -1)
+        {
+            const int saved_errno = errno;
+            ::close(fd);
+            throw std::runtime_error(std::string("Cannot stat ") + path + ": " + std::strerror(saved_errno));
+        }
 
-    char* endptr;
-    const long result = std::strtol(str, &endptr, base);
+        m_size = static_cast<size_t>(file_status.st_size);
+        if (m_size > 0) // mmap() rejects empty mappings
+        {
+            void* const data = ::mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                const int saved_errno = errno;
+                ::close(fd);
+                throw std::runtime_error(std::string("Cannot map ") + path + ": " + std::strerror(saved_errno));
+            }
+
+            ::madvise(data, m_size, MADV_SEQUENTIAL); // just a hint, errors don't matter
+            m_data = static_cast<const char*>(data);
+        }
 
-    std::swap(saved_errno, errno); // restore errno
+        ::close(fd); // the mapping stays valid
+    }
 
-    if (*endptr != 0) // we didn't consume the whole string
+    ~file_mapping()
     {
-        throw number_parse_error();
+        if (m_data != NULL)
+        {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
     }
-    else if ((saved_errno == ERANGE) && ((result == LONG_MIN) || (result == LONG_MAX))) // overflow
+
+    const char* data() const
     {
-        throw number_parse_error();
+        return m_data;
     }
 
-    return result;
-}
+    size_t size() const
+    {
+        return m_size;
+    }
+}; // class file_mapping
 
-inline double parse_double(const char* str)
+// Anonymous memory whose pages are only allocated by the kernel when first written to
+class lazy_buffer : noncopyable
 {
-    if ((str == NULL) || (*str == 0)) // we don't accept empty strings
+private:
+
+    char* m_data;
+    size_t m_size;
+
+public:
+
+    explicit lazy_buffer(size_t size) :
+        m_data(NULL),
+        m_size(size)
     {
-        throw number_parse_error();
+        if (m_size > 0)
+        {
+            int flags = MAP_PRIVATE | MAP_ANON;
+#ifdef MAP_NORESERVE
+            flags |= MAP_NORESERVE;
+#endif
+            void* const data = ::mmap(NULL, m_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (data == MAP_FAILED)
+            {
+                throw std::bad_alloc();
+            }
+
+            m_data = static_cast<char*>(data);
+        }
     }
 
-    // we perform this check to reject hex numbers (supported in C++11) and string with leading spaces
-    for (const char* c = str; *c != 0; c++)
+    ~lazy_buffer()
     {
-        if (!(isdigit(*c) || (*c == '+') || (*c == '-') || (*c == '.') || (*c == 'e') || (*c == 'E')))
+        if (m_data != NULL)
         {
-            throw number_parse_error();
+            ::munmap(m_data, m_size);
         }
     }
 
-    int saved_errno = errno; // save errno
-    errno = 0; // reset errno
+    char* data() const
+    {
+        return m_data;
+    }
+}; // class lazy_buffer
 
-    char* endptr;
-    const double result = std::strtod(str, &endptr);
+} // namespace detail
 
-    std::swap(saved_errno, errno); // restore errno
+// file_mapping and lazy_buffer are base classes, rather than members,
+// so that they are constructed before buffer_context_base
+class mmap_file_context MJR_FINAL :
+    private detail::file_mapping,
+    private detail::lazy_buffer,
+    public detail::buffer_context_base
+{
+public:
 
-    if (*endptr != 0) // we didn't consume the whole string
+    explicit mmap_file_context(const char* path) :
+        detail::file_mapping(path),
+        detail::lazy_buffer(detail::file_mapping::size()),
+        detail::buffer_context_base(detail::file_mapping::data(), detail::lazy_buffer::data(), detail::file_mapping::size())
     {
-        throw number_parse_error();
     }
-    else if (saved_errno == ERANGE) // underflow or overflow
+
+    explicit mmap_file_context(const std::string& path) :
+        detail::file_mapping(path.c_str()),
+        detail::lazy_buffer(detail::file_mapping::size()),
+        detail::buffer_context_base(detail::file_mapping::data(), detail::lazy_buffer::data(), detail::file_mapping::size())
     {
-        throw number_parse_error();
     }
+}; // class mmap_file_context
 
-    return result;
-}
+#endif // MJR_MMAP_SUPPORTED
 
-static const size_t UTF16_ESCAPE_SEQ_LENGTH = 4;
+namespace detail
+{
 
-inline uint16_t parse_utf16_escape_sequence(const char* seq)
+// Bump-pointer storage for the strings decoded by istream_context. Strings are appended
+// contiguously to large chunks, whose sizes double up to MAX_CHUNK_SIZE. A string that
+// outgrows its chunk is moved to a new one before its address is handed out, so that the
+// addresses returned by string() stay valid until the arena is destroyed.
+class string_arena : noncopyable
 {
-    for (size_t i = 0; i < UTF16_ESCAPE_SEQ_LENGTH; i++)
+private:
+
+    std::vector<char*> m_chunks;
+    char* m_chunk; // the last chunk, where the current string is being written
+    size_t m_chunk_size;
+    size_t m_used; // bytes used in the last chunk
+    size_t m_string_offset; // where the current string begins in the last chunk
+
+    // moves the current string to a new chunk with room for at least size more bytes
+    void grow(size_t size)
     {
-        if (!isxdigit(seq[i]))
+        const size_t string_size = m_used - m_string_offset;
+        const size_t chunk_size = std::max(
+            std::min(2 * m_chunk_size, static_cast<size_t>(MAX_CHUNK_SIZE)),
+            std::max(static_cast<size_t>(MIN_CHUNK_SIZE), 2 * (string_size + size)));
+
+        m_chunks.reserve(m_chunks.size() + 1); // so that push_back() below can't throw
+        char* const chunk = new char[chunk_size];
+        m_chunks.push_back(chunk);
+
+        if (string_size > 0)
+        {
+            std::memcpy(chunk, m_chunk + m_string_offset, string_size);
+        }
+
+        if ((m_chunk != NULL) && (m_string_offset == 0))
         {
-            throw encoding_error();
+            // the old chunk only contained the current string
+            delete[] m_chunk;
+            m_chunks.erase(m_chunks.end() - 2);
         }
+
+        m_chunk = chunk;
+        m_chunk_size = chunk_size;
+        m_used = string_size;
+        m_string_offset = 0;
     }
 
-    return static_cast<uint16_t>(parse_long(seq, 16));
-}
+public:
 
-template<typename Context>
-void write_utf8_char(Context& context, const utf8_char& c)
-{
-    for (size_t i = 0; i < sizeof(c.bytes); i++)
+    static const size_t MIN_CHUNK_SIZE = 4096;
+    static const size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+    string_arena() :
+        m_chunk(NULL),
+        m_chunk_size(0),
+        m_used(0),
+        m_string_offset(0)
     {
-        const char byte = c[i];
-        if ((i > 0) && (byte == 0))
+    }
+
+    ~string_arena()
+    {
+        for (size_t i = 0; i < m_chunks.size(); i++)
         {
-            break;
+            delete[] m_chunks[i];
         }
-
-        context.write(byte);
     }
-}
 
-template<typename Context>
-void read_quoted_string(Context& context, bool skip_opening_quote = false)
-{
-    enum
+    void new_string()
     {
-        OPENING_QUOTE,
-        CHARACTER,
-        ESCAPE_SEQUENCE,
-        UTF16_SEQUENCE,
-        CLOSED
-    } state = (skip_opening_quote) ? CHARACTER : OPENING_QUOTE;
+        m_string_offset = m_used;
+    }
 
-    bool empty = true;
-    char utf16_seq[UTF16_ESCAPE_SEQ_LENGTH + 1] = { 0 };
-    size_t utf16_seq_offset = 0;
-    uint16_t high_surrogate = 0;
+    void append(char c)
+    {
+        if (m_used == m_chunk_size)
+        {
+            grow(1);
+        }
 
-    char c;
+        m_chunk[m_used++] = c;
+    }
 
-    while ((state != CLOSED) && ((c = context.read()) != 0))
+    void append(const char* data, size_t size)
     {
-        empty = false;
-
-        switch (state)
+        if (size == 0)
         {
-        case OPENING_QUOTE:
+            return; // there may be no chunk yet, and memcpy() doesn't accept NULL
+        }
 
-            if (c != '"')
-            {
-                throw parse_error(context, parse_error::EXPECTED_OPENING_QUOTE);
-            }
-            state = CHARACTER;
+        if (m_chunk_size - m_used < size)
+        {
+            grow(size);
+        }
 
-            break;
+        std::memcpy(m_chunk + m_used, data, size);
+        m_used += size;
+    }
 
-        case CHARACTER:
+    // the current string, or NULL if it is empty
+    const char* string() const
+    {
+        return (m_used != m_string_offset) ? m_chunk + m_string_offset : NULL;
+    }
 
-            if (c == '\\')
-            {
-                state = ESCAPE_SEQUENCE;
-            }
-            else if (high_surrogate != 0)
-            {
-                throw parse_error(context, parse_error::EXPECTED_UTF16_LOW_SURROGATE);
-            }
-            else if (c == '"')
-            {
-                state = CLOSED;
-            }
-            else
-            {
-                context.write(c);
-            }
+    size_t chunk_count() const
+    {
+        return m_chunks.size();
+    }
+}; // class string_arena
 
-            break;
+} // namespace detail
 
-        case ESCAPE_SEQUENCE:
+class istream_context MJR_FINAL : public detail::context_base, public detail::windowed_context
+{
+private:
 
-            state = CHARACTER;
+    std::istream& m_stream;
+    size_t m_read_offset;
+    std::vector<char> m_block;
+    size_t m_block_size;
+    size_t m_fill_size; // the most the next fill() copies
+    size_t m_window_offset;
+    size_t m_window_size;
+    detail::string_arena m_write_buffers;
+
+    // Copies into the window what the stream buffer has already buffered (up to m_fill_size),
+    // asking it to fetch more input first if it has none: like get(), this never waits for more
+    // input than needed to return one character. Returns false at EOF or on error.
+    // m_fill_size starts small and doubles up to the block size, so that the input copied and
+    // then given back to the stream buffer stays small when many short messages are read from
+    // the same stream.
+    bool fill()
+    {
+        const std::istream::sentry sentry(m_stream, true);
+        if (!sentry)
+        {
+            return false;
+        }
 
-            switch (c)
-            {
-            case '"': context.write('"'); break;
-            case '\\': context.write('\\'); break;
-            case '/': context.write('/'); break;
-            case 'b': context.write('\b'); break;
-            case 'f': context.write('\f'); break;
-            case 'n': context.write('\n'); break;
-            case 'r': context.write('\r'); break;
-            case 't': context.write('\t'); break;
-            case 'u': state = UTF16_SEQUENCE; break;
-            default: throw parse_error(context, parse_error::INVALID_ESCAPE_SEQUENCE);
-            }
+        std::streambuf* const buffer = m_stream.rdbuf();
+        if (buffer->sgetc() == std::char_traits<char>::eof())
+        {
+            m_stream.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+            return false;
+        }
 
-            break;
+        const std::streamsize available = buffer->in_avail();
+        const size_t size = (available > 0) ? std::min(static_cast<size_t>(available), m_fill_size) : 1;
+        if (m_block.size() < size)
+        {
+            m_block.resize(m_fill_size);
+        }
+        m_fill_size = std::min(2 * m_fill_size, m_block_size);
 
-        case UTF16_SEQUENCE:
+        m_window_offset = 0;
+        m_window_size = static_cast<size_t>(buffer->sgetn(&m_block[0], size));
 
-            utf16_seq[utf16_seq_offset++] = c;
+        return m_window_size > 0;
+    }
 
-            if (utf16_seq_offset == sizeof(utf16_seq) - 1)
-            {
-                try
-                {
-                    const uint16_t code_unit = parse_utf16_escape_sequence(utf16_seq);
+public:
 
-                    if (high_surrogate != 0)
-                    {
-                        // we were waiting for the low surrogate (that now is code_unit)
-                        write_utf8_char(context, utf16_to_utf8(high_surrogate, code_unit));
-                        high_surrogate = 0;
-                    }
-                    else if (code_unit >= 0xD800 && code_unit <= 0xDBFF)
-                    {
-                        high_surrogate = code_unit;
-                    }
-                    else
-                    {
-                        write_utf8_char(context, utf16_to_utf8(code_unit, 0));
-                    }
-                }
-                catch (const encoding_error&)
-                {
-                    throw parse_error(context, parse_error::INVALID_UTF16_CHARACTER);
-                }
+    static const size_t DEFAULT_BLOCK_SIZE = 4096;
+    static const size_t INITIAL_FILL_SIZE = 64;
 
-                utf16_seq_offset = 0;
+    explicit istream_context(std::istream& stream, size_t block_size = DEFAULT_BLOCK_SIZE) :
+        m_stream(stream),
+        m_read_offset(0),
+        m_block(std::min(std::max(block_size, static_cast<size_t>(1)), static_cast<size_t>(INITIAL_FILL_SIZE))),
+        m_block_size(std::max(block_size, static_cast<size_t>(1))),
+        m_fill_size(m_block.size()),
+        m_window_offset(0),
+        m_window_size(0)
+    {
+        new_write_buffer();
+    }
 
-                state = CHARACTER;
+    ~istream_context()
+    {
+        // give the input we buffered but did not consume back to the stream buffer,
+        // so that the stream is positioned right after the parsed message
+        std::streambuf* const buffer = m_stream.rdbuf();
+        for (size_t i = m_window_offset; (i < m_window_size) && (buffer != NULL); i++)
+        {
+            if (buffer->sungetc() == std::char_traits<char>::eof())
+            {
+                break;
             }
+        }
+    }
 
-            break;
+    char read()
+    {
+        if ((m_window_offset == m_window_size) && !fill())
+        {
+            return 0;
+        }
 
-        case CLOSED: // to silence compiler warnings
+        m_read_offset++;
 
-            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
-        }
+        return m_block[m_window_offset++];
     }
 
-    if (empty && !skip_opening_quote)
+    size_t read_offset() const
     {
-        throw parse_error(context, parse_error::EXPECTED_OPENING_QUOTE);
+        return m_read_offset;
     }
-    else if (state != CLOSED)
+
+    const char* read_window() const
     {
-        throw parse_error(context, parse_error::EXPECTED_CLOSING_QUOTE);
+        return &m_block[0] + m_window_offset;
     }
 
-    context.write(0);
-}
-
-// reads any value that is not a string (or an object/array)
-template<typename Context>
-char read_unquoted_value(Context& context, char first_char = 0)
-{
-    if (first_char != 0)
+    size_t read_window_size() const
     {
-        context.write(first_char);
+        return m_window_size - m_window_offset;
     }
 
-    char c;
-
-    while (((c = context.read()) != 0) && (c != ',') && (c != '}') && (c != ']') && !isspace(c))
+    void consume(size_t size)
     {
-        context.write(c);
+        m_window_offset += size;
+        m_read_offset += size;
     }
 
-    if (c == 0)
+    void new_write_buffer()
     {
-        throw parse_error(context, parse_error::UNTERMINATED_VALUE);
+        m_write_buffers.new_string();
     }
 
-    context.write(0);
+    void write(char c)
+    {
+        m_write_buffers.append(c);
+    }
 
-    return c; // return the termination character (or it will be lost forever)
-}
+    void write(const char* data, size_t size)
+    {
+        m_write_buffers.append(data, size);
+    }
 
-} // namespace detail
+    // This method to retrieve the address of the write buffer MUST be called
+    // AFTER all the calls to write() for the current write buffer have been performed
+    const char* write_buffer() const
+    {
+        return m_write_buffers.string();
+    }
+}; // class istream_context
 
-class value_type_string MJR_FINAL
+namespace detail
 {
-    private:
-        value_type m_type;
 
-    public:
-        explicit value_type_string(value_type type = Null)
-        {
-            m_type = type;
-        }
+struct utf8_char
+{
+    uint8_t bytes[4];
 
-        std::string to_string() {
+    utf8_char()
+    {
+        // wanted use value-initialization, but couldn't because of a weird VS2013 warning
+        std::fill_n(bytes, sizeof(bytes), 0);
+    }
+
+    explicit utf8_char(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
+    {
+        bytes[0] = b0;
+        bytes[1] = b1;
+        bytes[2] = b2;
+        bytes[3] = b3;
+    }
+
+    uint8_t& operator[](size_t i)
+    {
+        return bytes[i];
+    }
+
+    const uint8_t& operator[](size_t i) const
+    {
+        return bytes[i];
+    }
+
+    bool operator==(const utf8_char& other) const
+    {
+        return std::equal(bytes, bytes + sizeof(bytes), other.bytes);
+    }
+
+    bool operator!=(const utf8_char& other) const
+    {
+        return !operator==(other);
+    }
+}; // struct utf8_char
+
+// this exception is not to be propagated outside minijson
+struct encoding_error
+{
+};
+
+inline bool utf16_to_utf32(uint16_t high, uint16_t low, uint32_t& result)
+{
+    if (high <= 0xD7FF || high >= 0xE000)
+    {
+        if (low != 0)
+        {
+            // since the high code unit is not a surrogate, the low code unit should be zero
+            return false;
+        }
+
+        result = high;
+    }
+    else
+    {
+        if (high > 0xDBFF) // we already know high >= 0xD800
+        {
+            // the high surrogate is not within the expected range
+            return false;
+        }
+
+        if (low < 0xDC00 || low > 0xDFFF)
+        {
+            // the low surrogate is not within the expected range
+            return false;
+        }
+
+        high -= 0xD800;
+        low -= 0xDC00;
+        result = 0x010000 + ((high << 10) | low);
+    }
+
+    return true;
+}
+
+inline uint32_t utf16_to_utf32(uint16_t high, uint16_t low)
+{
+    uint32_t result;
+
+    if (!utf16_to_utf32(high, low, result))
+    {
+        throw encoding_error();
+    }
+
+    return result;
+}
+
+inline bool utf32_to_utf8(uint32_t utf32_char, utf8_char& result)
+{
+    result = utf8_char();
+
+    if      (utf32_char <= 0x00007F)
+    {
+        result[0] = utf32_char;
+    }
+    else if (utf32_char <= 0x0007FF)
+    {
+        result[0] = 0xC0 | ((utf32_char & (0x1F <<  6)) >>  6);
+        result[1] = 0x80 | ((utf32_char & (0x3F      ))      );
+    }
+    else if (utf32_char <= 0x00FFFF)
+    {
+        result[0] = 0xE0 | ((utf32_char & (0x0F << 12)) >> 12);
+        result[1] = 0x80 | ((utf32_char & (0x3F <<  6)) >>  6);
+        result[2] = 0x80 | ((utf32_char & (0x3F      ))      );
+    }
+    else if (utf32_char <= 0x1FFFFF)
+    {
+        result[0] = 0xF0 | ((utf32_char & (0x07 << 18)) >> 18);
+        result[1] = 0x80 | ((utf32_char & (0x3F << 12)) >> 12);
+        result[2] = 0x80 | ((utf32_char & (0x3F <<  6)) >>  6);
+        result[3] = 0x80 | ((utf32_char & (0x3F      ))      );
+    }
+    else
+    {
+        // invalid code unit
+        return false;
+    }
+
+    return true;
+}
+
+inline utf8_char utf32_to_utf8(uint32_t utf32_char)
+{
+    utf8_char result;
+
+    if (!utf32_to_utf8(utf32_char, result))
+    {
+        throw encoding_error();
+    }
+
+    return result;
+}
+
+inline bool utf16_to_utf8(uint16_t high, uint16_t low, utf8_char& result)
+{
+    uint32_t utf32_char;
+
+    return utf16_to_utf32(high, low, utf32_char) && utf32_to_utf8(utf32_char, result);
+}
+
+inline utf8_char utf16_to_utf8(uint16_t high, uint16_t low)
+{
+    return utf32_to_utf8(utf16_to_utf32(high, low));
+}
+
+// selects the value constructor for numbers that are only converted on demand
+struct lazy_number_tag
+{
+};
+
+// this exception is not to be propagated outside minijson
+struct number_parse_error
+{
+};
+
+#ifdef MJR_LITTLE_ENDIAN
+
+// true if the 8 bytes of word are all ASCII digits
+inline bool is_eight_digits(uint64_t word)
+{
+    return (((word & 0xF0F0F0F0F0F0F0F0ULL) | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+        0x3333333333333333ULL);
+}
+
+// the value of the 8 ASCII digits in word, the first one being in the lowest byte
+inline uint32_t parse_eight_digits(uint64_t word)
+{
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8); // pairs of digits
+    word = (((word & 0x000000FF000000FFULL) * 0x000F424000000064ULL) + // 100 + (1000000 << 32)
+        (((word >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >> 32; // 1 + (10000 << 32)
+
+    return static_cast<uint32_t>(word);
+}
+
+#endif // MJR_LITTLE_ENDIAN
+
+// the value of c as a digit in bases up to 36, or 36 if c is not a digit
+inline unsigned int digit_value(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    else if ((c >= 'a') && (c <= 'z'))
+    {
+        return c - 'a' + 10;
+    }
+    else if ((c >= 'A') && (c <= 'Z'))
+    {
+        return c - 'A' + 10;
+    }
+
+    return 36;
+}
+
+// Parses [begin, end) as an optional sign followed by one or more digits in the given base
+// (and, when base is 16, an optional 0x or 0X prefix), without depending on the locale or errno.
+// Returns false on any other input, or if the magnitude of the number does not fit in 64 bits.
+inline bool parse_integer(const char* begin, const char* end, uint64_t& magnitude, bool& negative, unsigned int base = 10)
+{
+    const char* p = begin;
+
+    negative = (p != end) && (*p == '-');
+    if ((p != end) && ((*p == '-') || (*p == '+')))
+    {
+        p++;
+    }
+
+    if ((base == 16) && (end - p > 2) && (p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X')))
+    {
+        p += 2;
+    }
+
+    if (p == end)
+    {
+        return false;
+    }
+
+    while ((end - p > 1) && (*p == '0')) // leading zeros don't count towards overflow
+    {
+        p++;
+    }
+
+    uint64_t result = 0;
+
+    if (base == 10)
+    {
+        // up to 19 decimal digits always fit in 64 bits
+        const char* const safe_end = p + std::min(end - p, static_cast<std::ptrdiff_t>(19));
+
+#ifdef MJR_LITTLE_ENDIAN
+        while (safe_end - p >= 8)
+        {
+            const uint64_t word = load_uint64(p);
+            if (!is_eight_digits(word))
+            {
+                break;
+            }
+
+            result = (result * 100000000) + parse_eight_digits(word);
+            p += 8;
+        }
+#endif
+
+        for (; p != safe_end; p++)
+        {
+            const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+            if (digit > 9)
+            {
+                return false;
+            }
+
+            result = (result * 10) + digit;
+        }
+    }
+
+    // the remaining digits may overflow
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    for (; p != end; p++)
+    {
+        const unsigned int digit = digit_value(*p);
+        if ((digit >= base) || (result > (max - digit) / base))
+        {
+            return false;
+        }
+
+        result = (result * base) + digit;
+    }
+
+    magnitude = result;
+
+    return true;
+}
+
+inline bool parse_int64(const char* begin, const char* end, int64_t& result)
+{
+    uint64_t magnitude;
+    bool negative;
+
+    if (!parse_integer(begin, end, magnitude, negative))
+    {
+        return false;
+    }
+
+    const uint64_t max = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+    if (!negative && (magnitude <= max))
+    {
+        result = static_cast<int64_t>(magnitude);
+    }
+    else if (negative && (magnitude <= max + 1))
+    {
+        result = (magnitude == max + 1) ? std::numeric_limits<int64_t>::min() : -static_cast<int64_t>(magnitude);
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+inline bool parse_uint64(const char* begin, const char* end, uint64_t& result)
+{
+    uint64_t magnitude;
+    bool negative;
+
+    if (!parse_integer(begin, end, magnitude, negative) || (negative && (magnitude != 0)))
+    {
+        return false;
+    }
+
+    result = magnitude;
+
+    return true;
+}
+
+inline long parse_long(const char* str, int base = 10)
+{
+    if ((str == NULL) || (base < 2) || (base > 36))
+    {
+        throw number_parse_error();
+    }
+
+    uint64_t magnitude;
+    bool negative;
+
+    if (!parse_integer(str, str + std::strlen(str), magnitude, negative, base))
+    {
+        throw number_parse_error();
+    }
+
+    const uint64_t max = static_cast<uint64_t>(LONG_MAX);
+    if (!negative && (magnitude <= max))
+    {
+        return static_cast<long>(magnitude);
+    }
+    else if (negative && (magnitude <= max + 1))
+    {
+        return (magnitude == max + 1) ? LONG_MIN : -static_cast<long>(magnitude);
+    }
+
+    throw number_parse_error(); // overflow
+}
+
+// 128-bit approximations of the powers of five from 5^-342 to 5^308, normalized so that the most
+// significant bit is set (this is a class template only so that the table can live in a header)
+template<typename Dummy = void>
+struct powers_of_five
+{
+    static const int SMALLEST_EXPONENT = -342;
+    static const int LARGEST_EXPONENT = 308;
+
+    static const uint64_t table[2 * (LARGEST_EXPONENT - SMALLEST_EXPONENT + 1)];
+}; // struct powers_of_five
+
+template<typename Dummy>
+const uint64_t powers_of_five<Dummy>::table[2 * (LARGEST_EXPONENT - SMALLEST_EXPONENT + 1)] =
+{
+    0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL,
+    0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+    0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL,
+    0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+    0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL,
+    0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+    0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL,
+    0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+    0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL,
+    0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+    0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL,
+    0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+    0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL,
+    0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+    0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL,
+    0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+    0x84a57695fe98746dULL, 0x014bb630f7604b57ULL,
+    0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+    0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL,
+    0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+    0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL,
+    0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+    0xfd00b897478238d0ULL, 0x8920b098955522b4ULL,
+    0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+    0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL,
+    0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+    0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL,
+    0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+    0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL,
+    0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+    0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL,
+    0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+    0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL,
+    0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+    0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL,
+    0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+    0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL,
+    0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+    0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL,
+    0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+    0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL,
+    0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+    0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL,
+    0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+    0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL,
+    0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+    0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL,
+    0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+    0xa37fce126597973cULL, 0xe50ff107bab528a0ULL,
+    0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+    0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL,
+    0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+    0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL,
+    0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+    0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL,
+    0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+    0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL,
+    0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+    0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL,
+    0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+    0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL,
+    0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+    0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL,
+    0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+    0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL,
+    0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+    0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL,
+    0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+    0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL,
+    0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+    0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL,
+    0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+    0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL,
+    0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+    0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL,
+    0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+    0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL,
+    0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+    0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL,
+    0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+    0xc987434744ac874eULL, 0xa327ffb266b56220ULL,
+    0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+    0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL,
+    0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+    0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL,
+    0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+    0xc0314325637a1939ULL, 0xfa911155fefb5308ULL,
+    0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+    0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL,
+    0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+    0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL,
+    0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+    0xb749faed14125d36ULL, 0xcef980ec671f667bULL,
+    0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+    0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL,
+    0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+    0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL,
+    0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+    0xaecc49914078536dULL, 0x58fae9f773886e18ULL,
+    0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+    0x888f99797a5e012dULL, 0x6d8406c952429603ULL,
+    0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+    0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL,
+    0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+    0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL,
+    0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+    0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL,
+    0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+    0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL,
+    0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+    0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL,
+    0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+    0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL,
+    0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+    0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL,
+    0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+    0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL,
+    0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+    0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL,
+    0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+    0xb913179899f68584ULL, 0x28e2557b59846e3fULL,
+    0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+    0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL,
+    0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+    0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL,
+    0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+    0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL,
+    0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+    0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL,
+    0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+    0xd77485cb25823ac7ULL, 0x7d633293366b828bULL,
+    0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+    0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL,
+    0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+    0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL,
+    0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+    0xcd795be870516656ULL, 0x67902e276c921f8bULL,
+    0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+    0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL,
+    0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+    0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL,
+    0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+    0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL,
+    0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+    0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL,
+    0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+    0xef340a98172aace4ULL, 0x86fb897116c87c34ULL,
+    0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+    0xbae0a846d2195712ULL, 0x8974836059cca109ULL,
+    0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+    0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL,
+    0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+    0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL,
+    0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+    0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL,
+    0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+    0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL,
+    0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+    0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL,
+    0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+    0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL,
+    0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+    0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL,
+    0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+    0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL,
+    0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+    0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL,
+    0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+    0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL,
+    0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+    0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL,
+    0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+    0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL,
+    0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+    0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL,
+    0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+    0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL,
+    0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+    0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL,
+    0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+    0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL,
+    0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+    0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL,
+    0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+    0x8c974f7383725573ULL, 0x1e414218c73a13fbULL,
+    0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+    0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL,
+    0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+    0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL,
+    0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+    0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL,
+    0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+    0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL,
+    0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+    0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL,
+    0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+    0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL,
+    0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+    0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL,
+    0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+    0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL,
+    0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+    0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL,
+    0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+    0xbe89523386091465ULL, 0xf6bbb397f1135823ULL,
+    0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+    0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL,
+    0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+    0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL,
+    0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+    0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL,
+    0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+    0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL,
+    0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+    0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL,
+    0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+    0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL,
+    0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+    0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL,
+    0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+    0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL,
+    0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+    0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL,
+    0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+    0x811ccc668829b887ULL, 0x0806357d5a3f525fULL,
+    0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+    0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL,
+    0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+    0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL,
+    0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+    0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL,
+    0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+    0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL,
+    0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+    0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL,
+    0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+    0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL,
+    0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+    0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL,
+    0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+    0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL,
+    0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+    0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL,
+    0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+    0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL,
+    0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+    0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL,
+    0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+    0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL,
+    0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+    0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL,
+    0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+    0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL,
+    0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+    0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL,
+    0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+    0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL,
+    0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+    0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL,
+    0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+    0xc24452da229b021bULL, 0xfbe85badce996168ULL,
+    0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+    0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL,
+    0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+    0xed246723473e3813ULL, 0x290123e9aab23b68ULL,
+    0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+    0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL,
+    0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+    0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL,
+    0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+    0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL,
+    0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+    0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL,
+    0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+    0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL,
+    0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+    0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL,
+    0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+    0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+    0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+    0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+    0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+    0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+    0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+    0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+    0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+    0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+    0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+    0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+    0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+    0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+    0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+    0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+    0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+    0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+    0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+    0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL,
+    0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+    0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+    0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+    0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+    0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+    0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+    0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+    0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+    0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+    0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+    0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+    0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+    0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL,
+    0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL,
+    0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL,
+    0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL,
+    0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL,
+    0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL,
+    0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+    0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL,
+    0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+    0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+    0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+    0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL,
+    0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+    0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+    0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL,
+    0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+    0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+    0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+    0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+    0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+    0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL,
+    0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL,
+    0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL,
+    0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL,
+    0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL,
+    0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL,
+    0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL,
+    0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL,
+    0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL,
+    0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL,
+    0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL,
+    0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL,
+    0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL,
+    0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+    0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL,
+    0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+    0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL,
+    0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+    0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL,
+    0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+    0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL,
+    0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+    0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL,
+    0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+    0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL,
+    0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+    0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL,
+    0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+    0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL,
+    0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+    0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL,
+    0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+    0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL,
+    0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+    0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL,
+    0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+    0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL,
+    0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+    0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL,
+    0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+    0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL,
+    0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+    0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL,
+    0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+    0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL,
+    0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+    0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL,
+    0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+    0x924d692ca61be758ULL, 0x593c2626705f9c56ULL,
+    0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+    0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL,
+    0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+    0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL,
+    0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+    0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL,
+    0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+    0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL,
+    0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+    0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL,
+    0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+    0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL,
+    0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+    0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL,
+    0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+    0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL,
+    0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+    0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL,
+    0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+    0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL,
+    0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+    0x9ae757596946075fULL, 0x3375788de9b06958ULL,
+    0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+    0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL,
+    0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+    0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL,
+    0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+    0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL,
+    0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+    0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL,
+    0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+    0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL,
+    0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+    0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL,
+    0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+    0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL,
+    0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+    0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL,
+    0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+    0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL,
+    0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+    0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL,
+    0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+    0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL,
+    0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+    0x802221226be55a64ULL, 0xc2494954da2c9789ULL,
+    0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+    0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL,
+    0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+    0x9c69a97284b578d7ULL, 0xff2a760414536efbULL,
+    0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+    0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL,
+    0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+    0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL,
+    0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+    0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL,
+    0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+    0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL,
+    0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+    0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL,
+    0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+    0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL,
+    0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+    0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL,
+    0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+    0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL,
+    0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+    0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL,
+    0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+    0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL,
+    0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+    0xa59bc234db398c25ULL, 0x43fab9837e699095ULL,
+    0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+    0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL,
+    0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+    0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL,
+    0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+    0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL,
+    0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+    0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL,
+    0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+    0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL,
+    0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+    0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL,
+    0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+    0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL,
+    0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+    0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL,
+    0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+    0x8fa475791a569d10ULL, 0xf96e017d694487bcULL,
+    0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+    0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL,
+    0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+    0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL,
+    0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+    0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL,
+    0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+    0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL,
+    0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+    0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL,
+    0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+    0x82a45b450226b39cULL, 0xecc0024661173473ULL,
+    0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+    0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL,
+    0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+    0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL,
+    0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+    0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL,
+    0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+    0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL,
+    0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+    0x98165af37b2153deULL, 0xc3727a337a8b704aULL,
+    0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+    0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL,
+    0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+    0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL,
+    0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+    0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL,
+    0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+    0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL,
+    0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+    0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL,
+    0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+    0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL,
+    0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+    0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL,
+    0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+    0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL,
+    0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+    0x83ea2b892091e44dULL, 0x934aed0aab460432ULL,
+    0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+    0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL,
+    0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+    0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL,
+    0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+    0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL,
+    0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+    0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL,
+    0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+    0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL,
+    0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+    0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL,
+    0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+    0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL,
+    0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+    0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL,
+    0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+    0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL,
+    0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+    0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL,
+    0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+    0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL,
+    0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+    0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL,
+    0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+    0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL,
+    0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+    0x8533285c936b35deULL, 0xd53a88958f87275fULL,
+    0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+    0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL,
+    0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+    0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL,
+    0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+    0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL,
+    0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+    0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL,
+    0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+    0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL,
+    0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+    0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL,
+    0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+    0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL,
+    0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+    0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL,
+    0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+    0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL,
+    0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+    0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL,
+    0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+    0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL,
+    0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+    0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL,
+    0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+    0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL,
+    0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+    0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL,
+    0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+    0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL,
+    0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+    0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL,
+    0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+    0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL,
+    0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+    0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL,
+    0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+    0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL,
+    0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+    0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL,
+    0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+    0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL,
+    0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+    0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL,
+    0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+    0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL,
+    0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+    0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL,
+    0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+    0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL,
+};
+
+struct uint128
+{
+    uint64_t low;
+    uint64_t high;
+};
+
+inline uint128 full_multiplication(uint64_t a, uint64_t b)
+{
+    uint128 result;
+
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128_type;
+    const uint128_type product = static_cast<uint128_type>(a) * b;
+    result.low = static_cast<uint64_t>(product);
+    result.high = static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    result.low = _umul128(a, b, &result.high);
+#else
+    const uint64_t a_low = a & 0xFFFFFFFF, a_high = a >> 32;
+    const uint64_t b_low = b & 0xFFFFFFFF, b_high = b >> 32;
+    const uint64_t low_low = a_low * b_low;
+    const uint64_t low_high = a_low * b_high;
+    const uint64_t high_low = a_high * b_low;
+    const uint64_t middle = (low_low >> 32) + (low_high & 0xFFFFFFFF) + (high_low & 0xFFFFFFFF);
+    result.low = (middle << 32) | (low_low & 0xFFFFFFFF);
+    result.high = (a_high * b_high) + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+#endif
+
+    return result;
+}
+
+static const int DOUBLE_MANTISSA_BITS = 52; // not counting the implicit bit
+static const int DOUBLE_INFINITE_EXPONENT = 0x7FF;
+
+// Eisel-Lemire: rounds w * 10^q (w != 0) to the nearest double, returning its biased exponent and
+// its mantissa without the implicit bit. The exponent is DOUBLE_INFINITE_EXPONENT on overflow, and both
+// are 0 on underflow. The result is exact: 128 bits of the power of five are always enough for 64-bit w.
+inline void eisel_lemire(uint64_t w, int q, uint64_t& mantissa, int& exponent)
+{
+    if (q < powers_of_five<>::SMALLEST_EXPONENT)
+    {
+        mantissa = 0;
+        exponent = 0;
+        return;
+    }
+    else if (q > powers_of_five<>::LARGEST_EXPONENT)
+    {
+        mantissa = 0;
+        exponent = DOUBLE_INFINITE_EXPONENT;
+        return;
+    }
+
+    const int leading_zeros = count_leading_zeros(w);
+    w <<= leading_zeros;
+
+    // the product of w and the truncated power of five; the second half of the power is only
+    // needed when the bits below the ones we keep could carry into them
+    const size_t index = 2 * static_cast<size_t>(q - powers_of_five<>::SMALLEST_EXPONENT);
+    uint128 product = full_multiplication(w, powers_of_five<>::table[index]);
+    const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> (DOUBLE_MANTISSA_BITS + 3);
+    if ((product.high & precision_mask) == precision_mask)
+    {
+        const uint128 second_product = full_multiplication(w, powers_of_five<>::table[index + 1]);
+        product.low += second_product.high;
+        if (second_product.high > product.low)
+        {
+            product.high++;
+        }
+    }
+
+    const int upper_bit = static_cast<int>(product.high >> 63);
+    const int shift = upper_bit + 64 - DOUBLE_MANTISSA_BITS - 3;
+
+    mantissa = product.high >> shift;
+    // floor(q * log2(10)) + 63, plus the adjustments for the normalization and the exponent bias
+    exponent = ((((152170 + 65536) * q) >> 16) + 63) + upper_bit - leading_zeros + 1023;
+
+    if (exponent <= 0) // subnormal
+    {
+        if (-exponent + 1 >= 64)
+        {
+            mantissa = 0;
+            exponent = 0;
+            return;
+        }
+
+        mantissa >>= -exponent + 1;
+        mantissa += (mantissa & 1); // round to nearest
+        mantissa >>= 1;
+        // rounding may have brought the number back to the normal range
+        exponent = (mantissa < (1ULL << DOUBLE_MANTISSA_BITS)) ? 0 : 1;
+        mantissa &= ~(1ULL << DOUBLE_MANTISSA_BITS);
+        return;
+    }
+
+    // exactly halfway between two doubles: this can only happen for small exponents, round to even
+    if ((product.low <= 1) && (q >= -4) && (q <= 23) && ((mantissa & 3) == 1) && ((mantissa << shift) == product.high))
+    {
+        mantissa &= ~1ULL;
+    }
+
+    mantissa += (mantissa & 1); // round to nearest
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << DOUBLE_MANTISSA_BITS)) // rounding overflowed into the next power of two
+    {
+        mantissa = (1ULL << DOUBLE_MANTISSA_BITS);
+        exponent++;
+    }
+
+    mantissa &= ~(1ULL << DOUBLE_MANTISSA_BITS);
+    if (exponent >= DOUBLE_INFINITE_EXPONENT)
+    {
+        mantissa = 0;
+        exponent = DOUBLE_INFINITE_EXPONENT;
+    }
+}
+
+// Correctly rounded, but slow: only used for the rare numbers with more than 19 significant digits that
+// are too close to the halfway point between two doubles for their first 19 digits to tell them apart.
+// [begin, end) must have already been validated, so that only the decimal point depends on the locale.
+inline bool parse_double_slow(const char* begin, const char* end, double& result)
+{
+    std::string str(begin, end);
+    std::replace(str.begin(), str.end(), '.', *std::localeconv()->decimal_point);
+
+    const int saved_errno = errno;
+
+    char* endptr;
+    result = std::strtod(str.c_str(), &endptr);
+
+    errno = saved_errno;
+
+    // the number is known not to be zero, so a zero result means underflow
+    return (endptr == str.c_str() + str.size()) && (result != 0) &&
+        (result <= std::numeric_limits<double>::max()) && (result >= -std::numeric_limits<double>::max());
+}
+
+// Parses [begin, end) as the optional exponent that ends a number (an empty range meaning no exponent).
+// The result saturates way past the range of double, so that it can't overflow.
+inline bool parse_exponent(const char* begin, const char* end, int64_t& exponent)
+{
+    exponent = 0;
+
+    const char* p = begin;
+    if (p == end)
+    {
+        return true;
+    }
+    else if ((*p != 'e') && (*p != 'E'))
+    {
+        return false;
+    }
+
+    p++;
+
+    const bool negative = (p != end) && (*p == '-');
+    if ((p != end) && ((*p == '-') || (*p == '+')))
+    {
+        p++;
+    }
+
+    if (p == end)
+    {
+        return false;
+    }
+
+    for (; p != end; p++)
+    {
+        const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+        if (digit > 9)
+        {
+            return false;
+        }
+
+        if (exponent < 0x10000)
+        {
+            exponent = (exponent * 10) + digit;
+        }
+    }
+
+    exponent = negative ? -exponent : exponent;
+
+    return true;
+}
+
+// Parses [begin, end) as an optional sign followed by digits with an optional fraction and an optional
+// exponent, correctly rounded to the nearest double, without depending on the locale or errno.
+// Returns false on any other input, or if the number overflows or underflows.
+inline bool parse_double(const char* begin, const char* end, double& result)
+{
+    const char* p = begin;
+
+    const bool negative = (p != end) && (*p == '-');
+    if ((p != end) && ((*p == '-') || (*p == '+')))
+    {
+        p++;
+    }
+
+    // the number is w * 10^exponent, where w holds up to the first 19 significant digits
+    static const size_t MAX_SIGNIFICANT_DIGITS = 19;
+    uint64_t w = 0;
+    size_t significant_digits = 0;
+    size_t digits = 0;
+    int64_t exponent = 0;
+    bool truncated = false;
+
+    for (bool fraction = false; p != end; )
+    {
+        if ((*p == '.') && !fraction)
+        {
+            fraction = true;
+            p++;
+            continue;
+        }
+
+#ifdef MJR_LITTLE_ENDIAN
+        // once past the leading zeros, take the digits eight at a time
+        if ((w != 0) && (significant_digits + 8 <= MAX_SIGNIFICANT_DIGITS) && (end - p >= 8))
+        {
+            const uint64_t word = load_uint64(p);
+            if (is_eight_digits(word))
+            {
+                w = (w * 100000000) + parse_eight_digits(word);
+                significant_digits += 8;
+                digits += 8;
+                exponent -= fraction ? 8 : 0;
+                p += 8;
+                continue;
+            }
+        }
+#endif
+
+        const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+        if (digit > 9)
+        {
+            break;
+        }
+
+        digits++;
+        if (significant_digits < MAX_SIGNIFICANT_DIGITS)
+        {
+            w = (w * 10) + digit;
+            significant_digits += (w != 0);
+            exponent -= fraction;
+        }
+        else
+        {
+            truncated |= (digit != 0);
+            exponent += !fraction;
+        }
+
+        p++;
+    }
+
+    if (digits == 0)
+    {
+        return false;
+    }
+
+    int64_t explicit_exponent;
+    if (!parse_exponent(p, end, explicit_exponent))
+    {
+        return false;
+    }
+
+    exponent += explicit_exponent;
+
+    if (w == 0)
+    {
+        result = negative ? -0.0 : 0.0;
+        return true;
+    }
+
+#if !defined(FLT_EVAL_METHOD) || (FLT_EVAL_METHOD == 0)
+    // Clinger's fast path: both w and the power of ten are exact doubles, so a single
+    // correctly rounded operation gives the correctly rounded result
+    if (!truncated && (w <= (1ULL << (DOUBLE_MANTISSA_BITS + 1))) && (exponent >= -22) && (exponent <= 22))
+    {
+        static const double exact_powers_of_ten[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+
+        result = static_cast<double>(w);
+        result = (exponent < 0) ? result / exact_powers_of_ten[-exponent] : result * exact_powers_of_ten[exponent];
+        result = negative ? -result : result;
+        return true;
+    }
+#endif
+
+    const int q = static_cast<int>(std::max<int64_t>(std::min<int64_t>(exponent, 0x10000), -0x10000));
+
+    uint64_t mantissa;
+    int binary_exponent;
+    eisel_lemire(w, q, mantissa, binary_exponent);
+
+    if (truncated)
+    {
+        // the dropped digits put the number between w and w + 1
+        uint64_t upper_mantissa;
+        int upper_binary_exponent;
+        eisel_lemire(w + 1, q, upper_mantissa, upper_binary_exponent);
+
+        if ((mantissa != upper_mantissa) || (binary_exponent != upper_binary_exponent))
+        {
+            return parse_double_slow(begin, end, result);
+        }
+    }
+
+    if ((binary_exponent == DOUBLE_INFINITE_EXPONENT) || ((binary_exponent == 0) && (mantissa == 0)))
+    {
+        return false; // overflow or underflow
+    }
+
+    const uint64_t bits = mantissa | (static_cast<uint64_t>(binary_exponent) << DOUBLE_MANTISSA_BITS) |
+        (static_cast<uint64_t>(negative) << 63);
+    std::memcpy(&result, &bits, sizeof(result));
+
+    return true;
+}
+
+inline double parse_double(const char* str)
+{
+    double result;
+
+    if ((str == NULL) || !parse_double(str, str + std::strlen(str), result))
+    {
+        throw number_parse_error();
+    }
+
+    return result;
+}
+
+// the first character past the run of digits starting at p
+inline const char* skip_digits(const char* p, const char* end)
+{
+#ifdef MJR_LITTLE_ENDIAN
+    while ((end - p >= 8) && is_eight_digits(load_uint64(p)))
+    {
+        p += 8;
+    }
+#endif
+
+    while ((p != end) && (static_cast<unsigned int>(static_cast<unsigned char>(*p) - '0') <= 9))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+// Checks that [begin, end) is a number parse_double accepts, without converting it: only numbers
+// with enough digits or a large enough exponent that they could overflow or underflow are parsed.
+// (integer is set to whether the number is written without a fraction and an exponent)
+inline bool is_valid_number(const char* begin, const char* end, bool& integer)
+{
+    const char* p = begin;
+
+    if ((p != end) && ((*p == '-') || (*p == '+')))
+    {
+        p++;
+    }
+
+    const char* const integer_begin = p;
+    p = skip_digits(p, end);
+    const std::ptrdiff_t integer_digits = p - integer_begin;
+
+    std::ptrdiff_t fraction_digits = 0;
+    integer = true;
+    if ((p != end) && (*p == '.'))
+    {
+        integer = false;
+        const char* const fraction_begin = ++p;
+        p = skip_digits(p, end);
+        fraction_digits = p - fraction_begin;
+    }
+
+    int64_t exponent;
+    if ((integer_digits + fraction_digits == 0) || !parse_exponent(p, end, exponent))
+    {
+        return false;
+    }
+
+    integer &= (p == end); // no exponent
+
+    // the number is between 10^(exponent - fraction_digits) and 10^(exponent + integer_digits), unless it is zero
+    if ((exponent + integer_digits < 300) && (exponent - fraction_digits > -300))
+    {
+        return true;
+    }
+
+    double result;
+    return parse_double(begin, end, result);
+}
+
+inline bool is_valid_number(const char* begin, const char* end)
+{
+    bool integer;
+
+    return is_valid_number(begin, end, integer);
+}
+
+static const size_t UTF16_ESCAPE_SEQ_LENGTH = 4;
+
+inline bool parse_utf16_escape_sequence(const char* seq, uint16_t& result)
+{
+    result = 0;
+
+    for (size_t i = 0; i < UTF16_ESCAPE_SEQ_LENGTH; i++)
+    {
+        const unsigned int digit = digit_value(seq[i]);
+        if (digit >= 16)
+        {
+            return false;
+        }
+
+        result = static_cast<uint16_t>((result << 4) | digit);
+    }
+
+    return true;
+}
+
+inline uint16_t parse_utf16_escape_sequence(const char* seq)
+{
+    uint16_t result;
+
+    if (!parse_utf16_escape_sequence(seq, result))
+    {
+        throw encoding_error();
+    }
+
+    return result;
+}
+
+static const uint32_t KEY_HASH_OFFSET_BASIS = 2166136261u;
+static const uint32_t KEY_HASH_PRIME = 16777619u;
+
+// FNV-1a of the field names
+inline uint32_t runtime_key_hash(const char* str, size_t length)
+{
+    uint32_t hash = KEY_HASH_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(str[i])) * KEY_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+// same as runtime_key_hash for a null-terminated string, whose length is computed along the way
+inline uint32_t runtime_key_hash_and_length(const char* str, size_t& length)
+{
+    uint32_t hash = KEY_HASH_OFFSET_BASIS;
+    const char* p = str;
+    for (; *p != 0; p++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*p)) * KEY_HASH_PRIME;
+    }
+
+    length = p - str;
+
+    return hash;
+}
+
+// the length and the hash (see runtime_key_hash) of a field name, accumulated while the parser
+// decodes it
+struct key_digest
+{
+    size_t length;
+    uint32_t hash;
+
+    key_digest() :
+        length(0),
+        hash(KEY_HASH_OFFSET_BASIS)
+    {
+    }
+
+    void add(char c)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * KEY_HASH_PRIME;
+        length++;
+    }
+
+    void add(const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * KEY_HASH_PRIME;
+        }
+        length += size;
+    }
+}; // struct key_digest
+
+// writes c, and adds it to digest unless it is NULL
+template<typename Context>
+void write_string_char(Context& context, char c, key_digest* digest)
+{
+    context.write(c);
+    if (digest != NULL)
+    {
+        digest->add(c);
+    }
+}
+
+template<typename Context>
+void write_utf8_char(Context& context, const utf8_char& c, key_digest* digest = NULL)
+{
+    for (size_t i = 0; i < sizeof(c.bytes); i++)
+    {
+        const char byte = c[i];
+        if ((i > 0) && (byte == 0))
+        {
+            break;
+        }
+
+        write_string_char(context, byte, digest);
+    }
+}
+
+// true for the bytes that end a run of verbatim string characters: quotes, backslashes,
+// and control characters (including the null character, which contexts use to signal EOF)
+inline bool is_string_special(char c)
+{
+    return (c == '"') || (c == '\\') || (static_cast<unsigned char>(c) < 0x20);
+}
+
+// returns a pointer to the first byte in [begin, end) for which is_string_special() is true,
+// or end if there is none
+inline const char* find_string_special(const char* begin, const char* end)
+{
+    const char* p = begin;
+
+#if defined(MJR_USE_AVX2)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control_max), chunk)); // chunk <= 0x1F
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        if (mask != 0)
+        {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#elif defined(MJR_USE_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk)); // chunk <= 0x1F
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        if (mask != 0)
+        {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#endif
+
+    for (; end - p >= 8; p += 8)
+    {
+        const uint64_t word = load_uint64(p);
+        if (swar_has_byte(word, '"') || swar_has_byte(word, '\\') || swar_has_less(word, 0x20))
+        {
+            break; // the byte loop below will locate it
+        }
+    }
+
+    while ((p != end) && !is_string_special(*p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+// Consumes and writes the longest run of bytes that need no decoding, starting at the current
+// read position, and adds it to digest unless it is NULL. Returns the length of the run, always 0
+// for contexts that are not windowed.
+template<typename Context>
+size_t read_string_run(Context&, const void*, key_digest*)
+{
+    return 0;
+}
+
+template<typename Context>
+size_t read_string_run(Context& context, const windowed_context*, key_digest* digest)
+{
+    const char* const begin = context.read_window();
+    const size_t size = find_string_special(begin, begin + context.read_window_size()) - begin;
+
+    if (size > 0)
+    {
+        if (digest != NULL)
+        {
+            digest->add(begin, size); // while the run is in the cache anyway
+        }
+        context.consume(size);
+        context.write(begin, size);
+    }
+
+    return size;
+}
+
+// JSON whitespace (isspace() also accepts \v and \f, which the parser still skips one at a time)
+inline bool is_json_whitespace(char c)
+{
+    return (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r');
+}
+
+// returns a pointer to the first byte in [begin, end) that is not JSON whitespace,
+// or end if there is none
+inline const char* find_non_whitespace(const char* begin, const char* end)
+{
+    const char* p = begin;
+
+    // whitespace runs are often empty or a single space, don't bother with wide loads
+    if ((p == end) || !is_json_whitespace(*p))
+    {
+        return p;
+    }
+
+#if defined(MJR_USE_AVX2)
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i carriage_return = _mm256_set1_epi8('\r');
+
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, newline)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, tab), _mm256_cmpeq_epi8(chunk, carriage_return)));
+        const uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(whitespace));
+        if (mask != 0)
+        {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#elif defined(MJR_USE_SSE2)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, tab), _mm_cmpeq_epi8(chunk, carriage_return)));
+        const uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+        if (mask != 0)
+        {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#endif
+
+    for (; end - p >= 8; p += 8)
+    {
+        const uint64_t word = load_uint64(p);
+        const uint64_t whitespace =
+            swar_equal_bytes(word, ' ') | swar_equal_bytes(word, '\n') |
+            swar_equal_bytes(word, '\t') | swar_equal_bytes(word, '\r');
+        if (whitespace != SWAR_HIGH_BITS)
+        {
+            break; // the byte loop below will locate the first non-whitespace byte
+        }
+    }
+
+    while ((p != end) && is_json_whitespace(*p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+// returns a pointer to the first byte in [begin, end) equal to c, or end if there is none
+inline const char* find_byte(const char* begin, const char* end, char c)
+{
+    const char* p = begin;
+
+#if defined(MJR_USE_AVX2)
+    const __m256i wanted = _mm256_set1_epi8(c);
+
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, wanted)));
+        if (mask != 0)
+        {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#elif defined(MJR_USE_SSE2)
+    const __m128i wanted = _mm_set1_epi8(c);
+
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, wanted)));
+        if (mask != 0)
+        {
+            return p + count_trailing_zeros(mask);
+        }
+    }
+#endif
+
+    for (; end - p >= 8; p += 8)
+    {
+        if (swar_has_byte(load_uint64(p), c))
+        {
+            break; // the byte loop below will locate it
+        }
+    }
+
+    while ((p != end) && (*p != c))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+// Consumes all the JSON whitespace at the current read position. Does nothing for contexts
+// that are not windowed: the parser skips whitespace one read() at a time anyway.
+template<typename Context>
+void skip_whitespace(Context&, const void*)
+{
+}
+
+template<typename Context>
+void skip_whitespace(Context& context, const windowed_context*)
+{
+    const char* const begin = context.read_window();
+    context.consume(find_non_whitespace(begin, begin + context.read_window_size()) - begin);
+}
+
+// records the error in the context and returns false, for the functions that don't throw
+template<typename Context>
+bool fail(Context& context, parse_error::error_reason reason)
+{
+    context.set_status(parse_status(parse_error(context, reason)));
+
+    return false;
+}
+
+// throws the error recorded by the functions that don't throw
+template<typename Context>
+void throw_error(const Context& context)
+{
+    throw context.status().error();
+}
+
+// When digest is not NULL, the length and the hash of the decoded string are added to it
+// along the way (the parser passes one for the field names whose handlers take a key).
+template<typename Context>
+bool try_read_quoted_string(Context& context, bool skip_opening_quote = false, key_digest* digest = NULL)
+{
+    enum
+    {
+        OPENING_QUOTE,
+        CHARACTER,
+        ESCAPE_SEQUENCE,
+        UTF16_SEQUENCE,
+        CLOSED
+    } state = (skip_opening_quote) ? CHARACTER : OPENING_QUOTE;
+
+    bool empty = true;
+    char utf16_seq[UTF16_ESCAPE_SEQ_LENGTH + 1] = { 0 };
+    size_t utf16_seq_offset = 0;
+    uint16_t high_surrogate = 0;
+
+    char c;
+
+    while (state != CLOSED)
+    {
+        if ((state == CHARACTER) && (high_surrogate == 0))
+        {
+            // copy everything up to the next quote, escape or control character in one go
+            read_string_run(context, &context, digest);
+        }
+
+        if ((c = context.read()) == 0)
+        {
+            break;
+        }
+
+        empty = false;
+
+        switch (state)
+        {
+        case OPENING_QUOTE:
+
+            if (c != '"')
+            {
+                return fail(context, parse_error::EXPECTED_OPENING_QUOTE);
+            }
+            state = CHARACTER;
+
+            break;
+
+        case CHARACTER:
+
+            if (c == '\\')
+            {
+                state = ESCAPE_SEQUENCE;
+            }
+            else if (high_surrogate != 0)
+            {
+                return fail(context, parse_error::EXPECTED_UTF16_LOW_SURROGATE);
+            }
+            else if (c == '"')
+            {
+                state = CLOSED;
+            }
+            else
+            {
+                write_string_char(context, c, digest);
+            }
+
+            break;
+
+        case ESCAPE_SEQUENCE:
+
+            state = CHARACTER;
+
+            switch (c)
+            {
+            case '"': write_string_char(context, '"', digest); break;
+            case '\\': write_string_char(context, '\\', digest); break;
+            case '/': write_string_char(context, '/', digest); break;
+            case 'b': write_string_char(context, '\b', digest); break;
+            case 'f': write_string_char(context, '\f', digest); break;
+            case 'n': write_string_char(context, '\n', digest); break;
+            case 'r': write_string_char(context, '\r', digest); break;
+            case 't': write_string_char(context, '\t', digest); break;
+            case 'u': state = UTF16_SEQUENCE; break;
+            default: return fail(context, parse_error::INVALID_ESCAPE_SEQUENCE);
+            }
+
+            break;
+
+        case UTF16_SEQUENCE:
+
+            utf16_seq[utf16_seq_offset++] = c;
+
+            if (utf16_seq_offset == sizeof(utf16_seq) - 1)
+            {
+                uint16_t code_unit;
+                utf8_char utf8;
+
+                if (!parse_utf16_escape_sequence(utf16_seq, code_unit))
+                {
+                    return fail(context, parse_error::INVALID_UTF16_CHARACTER);
+                }
+
+                if (high_surrogate != 0)
+                {
+                    // we were waiting for the low surrogate (that now is code_unit)
+                    if (!utf16_to_utf8(high_surrogate, code_unit, utf8))
+                    {
+                        return fail(context, parse_error::INVALID_UTF16_CHARACTER);
+                    }
+                    write_utf8_char(context, utf8, digest);
+                    high_surrogate = 0;
+                }
+                else if (code_unit >= 0xD800 && code_unit <= 0xDBFF)
+                {
+                    high_surrogate = code_unit;
+                }
+                else
+                {
+                    if (!utf16_to_utf8(code_unit, 0, utf8))
+                    {
+                        return fail(context, parse_error::INVALID_UTF16_CHARACTER);
+                    }
+                    write_utf8_char(context, utf8, digest);
+                }
+
+                utf16_seq_offset = 0;
+
+                state = CHARACTER;
+            }
+
+            break;
+
+        case CLOSED: // to silence compiler warnings
+
+            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+        }
+    }
+
+    if (empty && !skip_opening_quote)
+    {
+        return fail(context, parse_error::EXPECTED_OPENING_QUOTE);
+    }
+    else if (state != CLOSED)
+    {
+        return fail(context, parse_error::EXPECTED_CLOSING_QUOTE);
+    }
+
+    context.write(0);
+
+    return true;
+}
+
+template<typename Context>
+void read_quoted_string(Context& context, bool skip_opening_quote = false)
+{
+    if (!try_read_quoted_string(context, skip_opening_quote))
+    {
+        throw_error(context);
+    }
+}
+
+// Consumes and writes the rest of the unquoted value whose first byte was just read, if the
+// context has a structural index: the value ends where the next token begins, minus the whitespace
+// in between. Returns the number of bytes written, always 0 for contexts without an index, or when
+// the index doesn't agree with the input (which is then invalid).
+template<typename Context>
+size_t read_unquoted_run(Context&, const void*)
+{
+    return 0;
+}
+
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+
+template<typename Context>
+size_t read_unquoted_run(Context& context, const indexed_context*)
+{
+    const structural_index* const index = context.index();
+    if (index == NULL)
+    {
+        return 0;
+    }
+
+    const size_t token = context.next_token(context.read_offset());
+    const char* const begin = context.read_window();
+    size_t size = ((token < index->size()) ? index->offset(token) : context.length()) - context.read_offset();
+    while ((size > 0) && isspace(begin[size - 1]))
+    {
+        size--;
+    }
+
+    // the byte loop of try_read_unquoted_value would stop at the same byte
+    if ((size < context.read_window_size()) &&
+        !isspace(begin[size]) && (begin[size] != ',') && (begin[size] != '}') && (begin[size] != ']'))
+    {
+        return 0;
+    }
+
+    if (size > 0)
+    {
+        context.consume(size);
+        context.write(begin, size);
+    }
+
+    return size;
+}
+
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
+
+// reads any value that is not a string (or an object/array)
+// returns 0 on failure
+template<typename Context>
+char try_read_unquoted_value(Context& context, char first_char, size_t& length) // length doesn't include the null terminator
+{
+    length = 0;
+
+    if (first_char != 0)
+    {
+        context.write(first_char);
+        length++;
+        length += read_unquoted_run(context, &context);
+    }
+
+    char c;
+
+    while (((c = context.read()) != 0) && (c != ',') && (c != '}') && (c != ']') && !isspace(c))
+    {
+        context.write(c);
+        length++;
+    }
+
+    if (c == 0)
+    {
+        fail(context, parse_error::UNTERMINATED_VALUE);
+        return 0;
+    }
+
+    context.write(0);
+
+    return c; // return the termination character (or it will be lost forever)
+}
+
+template<typename Context>
+char read_unquoted_value(Context& context, char first_char = 0)
+{
+    size_t length;
+
+    const char c = try_read_unquoted_value(context, first_char, length);
+    if (c == 0)
+    {
+        throw_error(context);
+    }
+
+    return c;
+}
+
+} // namespace detail
+
+class value_type_string MJR_FINAL
+{
+    private:
+        value_type m_type;
+
+    public:
+        explicit value_type_string(value_type type = Null)
+        {
+            m_type = type;
+        }
+
+        std::string to_string() {
             switch (m_type) {
                 case String:
                     return "string";
@@ -773,444 +3379,2546 @@ class value_type_string MJR_FINAL
                 case Null:
                     return "null";
                 default:
-                    return "invalid type";
+                    return "invalid type";
+            }
+        }
+};
+
+
+class value MJR_FINAL
+{
+private:
+
+    const char* m_buffer;
+    union
+    {
+        long m_long_value; // if m_long_stored
+        double m_double_value; // otherwise
+    };
+    value_type m_type;
+    bool m_lazy_number; // the numeric representations are parsed from m_buffer on demand
+    bool m_integer;
+    bool m_long_stored; // the double representation is the long one, converted
+
+    long stored_long() const
+    {
+        if (m_long_stored)
+        {
+            return m_long_value;
+        }
+
+        // -LONG_MIN is exact as a double, unlike LONG_MAX, and NaN fails both comparisons
+        const double limit = -static_cast<double>(LONG_MIN);
+
+        return ((m_double_value >= -limit) && (m_double_value < limit)) ? static_cast<long>(m_double_value) : 0;
+    }
+
+public:
+
+    // Only one of long_value and double_value is kept: the double one is long_value converted
+    // when they are equal, and the long one is double_value truncated otherwise (or 0 if it
+    // doesn't fit in a long).
+    explicit value(value_type type = Null, const char* buffer = "", long long_value = 0, double double_value = 0.0) :
+        m_buffer(buffer),
+        m_type(type),
+        m_lazy_number(false),
+        m_integer((type == Number) && (static_cast<double>(long_value) == double_value)),
+        m_long_stored(static_cast<double>(long_value) == double_value)
+    {
+        if (m_long_stored)
+        {
+            m_long_value = long_value;
+        }
+        else
+        {
+            m_double_value = double_value;
+        }
+    }
+
+    // a Number whose representations are computed from buffer (which must outlive the value) only when asked for
+    value(const char* buffer, bool integer, detail::lazy_number_tag) :
+        m_buffer(buffer),
+        m_long_value(0),
+        m_type(Number),
+        m_lazy_number(true),
+        m_integer(integer),
+        m_long_stored(true)
+    {
+    }
+
+    value_type type() const
+    {
+        return m_type;
+    }
+
+    const char* as_string() const
+    {
+        return m_buffer;
+    }
+
+    // true if type() is Number and the number has neither a fraction nor an exponent
+    bool is_integer() const
+    {
+        return m_integer;
+    }
+
+    long as_long() const
+    {
+        if (!m_lazy_number)
+        {
+            return stored_long();
+        }
+
+        const int64_t result = as_int64();
+
+        return ((result >= LONG_MIN) && (result <= LONG_MAX)) ? static_cast<long>(result) : 0;
+    }
+
+    int64_t as_int64() const
+    {
+        if (!m_lazy_number)
+        {
+            return stored_long();
+        }
+        else if (!m_integer)
+        {
+            return 0;
+        }
+
+        int64_t result;
+
+        return detail::parse_int64(m_buffer, m_buffer + std::strlen(m_buffer), result) ? result : 0;
+    }
+
+    uint64_t as_uint64() const
+    {
+        if (!m_lazy_number)
+        {
+            const long result = stored_long();
+
+            return (result >= 0) ? static_cast<uint64_t>(result) : 0;
+        }
+        else if (!m_integer)
+        {
+            return 0;
+        }
+
+        uint64_t result;
+
+        return detail::parse_uint64(m_buffer, m_buffer + std::strlen(m_buffer), result) ? result : 0;
+    }
+
+    bool as_bool() const
+    {
+        return (as_long()) ? true : false; // to avoid VS2013 warnings
+    }
+
+    double as_double() const
+    {
+        if (!m_lazy_number)
+        {
+            return m_long_stored ? static_cast<double>(m_long_value) : m_double_value;
+        }
+
+        double result;
+
+        return detail::parse_double(m_buffer, m_buffer + std::strlen(m_buffer), result) ? result : 0.0;
+    }
+}; // class value
+
+// The name of an object field, as seen by the handlers of parse_object that take a const key&
+// instead of a const char*. The key also provides the length of the name and its hash (the one
+// used by dispatch_table and static_dispatch). In C++11 mode, parse_object computes both while it
+// decodes the name. Otherwise, and for keys converted from a const char*, they are computed
+// together on first use.
+class key MJR_FINAL
+{
+private:
+
+    const char* m_name;
+    mutable size_t m_length;
+    mutable uint32_t m_hash;
+    mutable bool m_measured;
+
+    void measure() const
+    {
+        if (!m_measured)
+        {
+            m_hash = detail::runtime_key_hash_and_length(m_name, m_length);
+            m_measured = true;
+        }
+    }
+
+public:
+
+    // not explicit, so that handlers can take a const key&
+    key(const char* name) :
+        m_name(name),
+        m_length(0),
+        m_hash(0),
+        m_measured(false)
+    {
+    }
+
+    // hash must be runtime_key_hash of the length bytes of name
+    explicit key(const char* name, size_t length, uint32_t hash) :
+        m_name(name),
+        m_length(length),
+        m_hash(hash),
+        m_measured(true)
+    {
+    }
+
+    const char* name() const
+    {
+        return m_name;
+    }
+
+    size_t length() const
+    {
+        measure();
+
+        return m_length;
+    }
+
+    uint32_t hash() const
+    {
+        measure();
+
+        return m_hash;
+    }
+
+    operator const char*() const
+    {
+        return m_name;
+    }
+}; // class key
+
+namespace detail
+{
+
+// takes_key<Handler>::value is true if the object handler takes a key as the field name, in which
+// case the parser computes its length and hash while it decodes it. Only handlers with a single,
+// non-template operator() (or function pointers) are recognized, and only in C++11 mode: all the
+// others get a const char*, and convert it themselves.
+template<typename Handler, typename Enable = void>
+struct takes_key
+{
+    enum { value = false };
+};
+
+#if MJR_CPP11_SUPPORTED
+
+template<typename Parameter>
+struct is_key_parameter
+{
+    enum { value = false };
+};
+
+template<>
+struct is_key_parameter<key>
+{
+    enum { value = true };
+};
+
+template<>
+struct is_key_parameter<const key>
+{
+    enum { value = true };
+};
+
+template<>
+struct is_key_parameter<const key&>
+{
+    enum { value = true };
+};
+
+template<typename Function>
+struct first_parameter
+{
+    typedef void type;
+};
+
+template<typename Class, typename Result, typename Parameter, typename... Rest>
+struct first_parameter<Result (Class::*)(Parameter, Rest...)>
+{
+    typedef Parameter type;
+};
+
+template<typename Class, typename Result, typename Parameter, typename... Rest>
+struct first_parameter<Result (Class::*)(Parameter, Rest...) const>
+{
+    typedef Parameter type;
+};
+
+#if defined(__cpp_noexcept_function_type)
+
+template<typename Class, typename Result, typename Parameter, typename... Rest>
+struct first_parameter<Result (Class::*)(Parameter, Rest...) noexcept>
+{
+    typedef Parameter type;
+};
+
+template<typename Class, typename Result, typename Parameter, typename... Rest>
+struct first_parameter<Result (Class::*)(Parameter, Rest...) const noexcept>
+{
+    typedef Parameter type;
+};
+
+#endif // __cpp_noexcept_function_type
+
+template<typename Result, typename Parameter, typename... Rest>
+struct takes_key<Result (*)(Parameter, Rest...), void>
+{
+    enum { value = is_key_parameter<Parameter>::value };
+};
+
+template<typename Handler>
+struct takes_key<Handler, decltype(void(&Handler::operator()))>
+{
+    enum { value = is_key_parameter<typename first_parameter<decltype(&Handler::operator())>::type>::value };
+};
+
+#endif // MJR_CPP11_SUPPORTED
+
+template<bool TakesKey>
+struct field_handler_caller
+{
+    template<typename Handler>
+    static void call(Handler& handler, const key& name, const value& v)
+    {
+        handler(name.name(), v);
+    }
+};
+
+template<>
+struct field_handler_caller<true>
+{
+    template<typename Handler>
+    static void call(Handler& handler, const key& name, const value& v)
+    {
+        handler(name, v);
+    }
+};
+
+// calls the object handler with the field name as a key if it takes one, as a const char* otherwise
+template<typename Handler>
+void call_field_handler(Handler& handler, const key& name, const value& v)
+{
+    field_handler_caller<takes_key<Handler>::value>::call(handler, name, v);
+}
+
+// classifies the unquoted value of the given length in buffer, returns false if it is invalid
+inline bool classify_unquoted_value(const char* buffer, size_t length, value& result)
+{
+    switch (buffer[0])
+    {
+    case 't':
+        if ((length == 4) && (std::memcmp(buffer, "true", 4) == 0))
+        {
+            result = value(Boolean, buffer, 1, 1.0);
+            return true;
+        }
+        break;
+    case 'f':
+        if ((length == 5) && (std::memcmp(buffer, "false", 5) == 0))
+        {
+            result = value(Boolean, buffer, 0, 0.0);
+            return true;
+        }
+        break;
+    case 'n':
+        if ((length == 4) && (std::memcmp(buffer, "null", 4) == 0))
+        {
+            result = value(Null, buffer, 0, 0.0);
+            return true;
+        }
+        break;
+    default:
+        {
+            bool integer;
+            if (is_valid_number(buffer, buffer + length, integer))
+            {
+                result = value(buffer, integer, lazy_number_tag());
+                return true;
+            }
+        }
+        break;
+    }
+
+    return false;
+}
+
+// classifies the unquoted value of the given length in the write buffer of the context
+template<typename Context>
+bool try_parse_unquoted_value(Context& context, size_t length, value& result)
+{
+    return classify_unquoted_value(context.write_buffer(), length, result) || fail(context, parse_error::INVALID_VALUE);
+}
+
+template<typename Context>
+value parse_unquoted_value(Context& context)
+{
+    value result;
+    if (!try_parse_unquoted_value(context, std::strlen(context.write_buffer()), result))
+    {
+        throw_error(context);
+    }
+
+    return result;
+}
+
+template<typename Context>
+bool try_read_value(Context& context, char first_char, std::pair<value, char>& result)
+{
+    if (first_char == '{')
+    {
+        result = std::make_pair(value(Object), 0);
+    }
+    else if (first_char == '[')
+    {
+        result = std::make_pair(value(Array), 0);
+    }
+    else if (first_char == '"') // quoted string
+    {
+        context.new_write_buffer();
+        if (!try_read_quoted_string(context, true))
+        {
+            return false;
+        }
+
+        result = std::make_pair(value(String, context.write_buffer()), 0);
+    }
+    else // unquoted value
+    {
+        context.new_write_buffer();
+        size_t length;
+        const char ending_char = try_read_unquoted_value(context, first_char, length);
+        if ((ending_char == 0) || !try_parse_unquoted_value(context, length, result.first))
+        {
+            return false;
+        }
+
+        result.second = ending_char;
+    }
+
+    return true;
+}
+
+template<typename Context>
+std::pair<value, char> read_value(Context& context, char first_char)
+{
+    std::pair<value, char> result;
+    if (!try_read_value(context, first_char, result))
+    {
+        throw_error(context);
+    }
+
+    return result;
+}
+
+template<typename Context>
+void parse_init_helper(const Context& context, char& c, bool& must_read)
+{
+    switch (context.nested_status())
+    {
+    case Context::NESTED_STATUS_NONE:
+        c = 0;
+        must_read = true;
+        break;
+    case Context::NESTED_STATUS_OBJECT:
+        c = '{';
+        must_read = false;
+        break;
+    case Context::NESTED_STATUS_ARRAY:
+        c = '[';
+        must_read = false;
+        break;
+    }
+}
+
+template<typename Context>
+bool parse_value_helper(Context& context, char& c, bool& must_read, value& v)
+{
+    std::pair<value, char> read_value_result;
+    if (!detail::try_read_value(context, c, read_value_result))
+    {
+        return false;
+    }
+
+    v = read_value_result.first;
+
+    if (v.type() == Object)
+    {
+        context.begin_nested(Context::NESTED_STATUS_OBJECT);
+    }
+    else if (v.type() == Array)
+    {
+        context.begin_nested(Context::NESTED_STATUS_ARRAY);
+    }
+    else if (v.type() != String)
+    {
+        c = read_value_result.second;
+        must_read = false;
+    }
+
+    return true;
+}
+
+template<typename Context, typename Handler>
+bool parse_object_helper(Context& context, Handler& handler)
+{
+    const size_t nesting_level = context.nesting_level();
+    if (nesting_level > MJR_NESTING_LIMIT)
+    {
+        return fail(context, parse_error::EXCEEDED_NESTING_LIMIT);
+    }
+
+    char c = 0;
+    bool must_read = false;
+
+    parse_init_helper(context, c, must_read);
+    context.reset_nested_status();
+
+    enum
+    {
+        OPENING_BRACKET,
+        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
+        FIELD_NAME,
+        COLON,
+        FIELD_VALUE,
+        COMMA_OR_CLOSING_BRACKET,
+        END
+    } state = OPENING_BRACKET;
+
+    const char* field_name = "";
+    key_digest field_digest;
+
+    while (state != END)
+    {
+        if (context.nesting_level() != nesting_level)
+        {
+            return fail(context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+        }
+
+        if (must_read)
+        {
+            detail::skip_whitespace(context, &context);
+            c = context.read();
+        }
+
+        must_read = true;
+
+        if (isspace(c)) // skip whitespace
+        {
+            continue;
+        }
+
+        switch (state)
+        {
+        case OPENING_BRACKET:
+            if (c != '{')
+            {
+                return fail(context, parse_error::EXPECTED_OPENING_BRACKET);
+            }
+            state = FIELD_NAME_OR_CLOSING_BRACKET;
+            break;
+
+        case FIELD_NAME_OR_CLOSING_BRACKET:
+            if (c == '}')
+            {
+                state = END;
+                break;
+            }
+            // intentional fall-through
+
+        case FIELD_NAME:
+            if (c != '"')
+            {
+                return fail(context, parse_error::EXPECTED_OPENING_QUOTE);
+            }
+            context.new_write_buffer();
+            field_digest = key_digest();
+            if (!try_read_quoted_string(context, true, takes_key<Handler>::value ? &field_digest : NULL))
+            {
+                return false;
+            }
+            field_name = context.write_buffer();
+            state = COLON;
+            break;
+
+        case COLON:
+            if (c != ':')
+            {
+                return fail(context, parse_error::EXPECTED_COLON);
+            }
+            state = FIELD_VALUE;
+            break;
+
+        case FIELD_VALUE:
+            {
+                value v;
+                if (!parse_value_helper(context, c, must_read, v))
+                {
+                    return false;
+                }
+                call_field_handler(handler, key(field_name, field_digest.length, field_digest.hash), v);
+            }
+            if (context.status().failed()) // the handler failed to parse a nested object or array
+            {
+                return false;
+            }
+            state = COMMA_OR_CLOSING_BRACKET;
+            break;
+
+        case COMMA_OR_CLOSING_BRACKET:
+            if (c == ',')
+            {
+                state = FIELD_NAME;
+            }
+            else if (c == '}')
+            {
+                state = END;
+            }
+            else
+            {
+                return fail(context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+            }
+            break;
+
+        case END:
+
+            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+        }
+
+        if (c == 0)
+        {
+            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+        }
+    }
+
+    context.end_nested();
+
+    return true;
+}
+
+template<typename Context, typename Handler>
+bool parse_array_helper(Context& context, Handler& handler)
+{
+    const size_t nesting_level = context.nesting_level();
+    if (nesting_level > MJR_NESTING_LIMIT)
+    {
+        return fail(context, parse_error::EXCEEDED_NESTING_LIMIT);
+    }
+
+    char c = 0;
+    bool must_read = false;
+
+    parse_init_helper(context, c, must_read);
+    context.reset_nested_status();
+
+    enum
+    {
+        OPENING_BRACKET,
+        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
+        VALUE,
+        COMMA_OR_CLOSING_BRACKET,
+        END
+    } state = OPENING_BRACKET;
+
+    while (state != END)
+    {
+        if (context.nesting_level() != nesting_level)
+        {
+            return fail(context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+        }
+
+        if (must_read)
+        {
+            detail::skip_whitespace(context, &context);
+            c = context.read();
+        }
+
+        must_read = true;
+
+        if (isspace(c)) // skip whitespace
+        {
+            continue;
+        }
+
+        switch (state)
+        {
+        case OPENING_BRACKET:
+            if (c != '[')
+            {
+                return fail(context, parse_error::EXPECTED_OPENING_BRACKET);
+            }
+            state = VALUE_OR_CLOSING_BRACKET;
+            break;
+
+        case VALUE_OR_CLOSING_BRACKET:
+            if (c == ']')
+            {
+                state = END;
+                break;
+            }
+            // intentional fall-through
+
+        case VALUE:
+            {
+                value v;
+                if (!parse_value_helper(context, c, must_read, v))
+                {
+                    return false;
+                }
+                handler(v);
+            }
+            if (context.status().failed()) // the handler failed to parse a nested object or array
+            {
+                return false;
+            }
+            state = COMMA_OR_CLOSING_BRACKET;
+            break;
+
+        case COMMA_OR_CLOSING_BRACKET:
+            if (c == ',')
+            {
+                state = VALUE;
+            }
+            else if (c == ']')
+            {
+                state = END;
+            }
+            else
+            {
+                return fail(context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+            }
+            break;
+
+        case END:
+
+            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+        }
+
+        if (c == 0)
+        {
+            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+        }
+    }
+
+    context.end_nested();
+
+    return true;
+}
+
+} // namespace detail
+
+template<typename Context, typename Handler>
+void parse_object(Context& context, Handler handler)
+{
+    if (!detail::parse_object_helper(context, handler))
+    {
+        detail::throw_error(context);
+    }
+}
+
+template<typename Context, typename Handler>
+void parse_array(Context& context, Handler handler)
+{
+    if (!detail::parse_array_helper(context, handler))
+    {
+        detail::throw_error(context);
+    }
+}
+
+// Same as parse_object, but errors are returned instead of being thrown. Nested objects and arrays
+// must be parsed with try_parse_object and try_parse_array as well (or ignored with try_ignore):
+// when they fail, the handler should just return, and the enclosing calls will report the same error.
+template<typename Context, typename Handler>
+parse_status try_parse_object(Context& context, Handler handler)
+{
+    return detail::parse_object_helper(context, handler) ? parse_status() : context.status();
+}
+
+// Same as parse_array, but errors are returned instead of being thrown (see try_parse_object)
+template<typename Context, typename Handler>
+parse_status try_parse_array(Context& context, Handler handler)
+{
+    return detail::parse_array_helper(context, handler) ? parse_status() : context.status();
+}
+
+namespace detail
+{
+
+class dispatch_rule; // forward declaration
+
+} // namespace detail
+
+class dispatch : detail::noncopyable
+{
+    friend class detail::dispatch_rule;
+
+private:
+
+    const char* m_field_name;
+    bool m_handled;
+
+public:
+
+    explicit dispatch(const char* field_name) :
+        m_field_name(field_name),
+        m_handled(false)
+    {
+    }
+
+    explicit dispatch(const std::string& field_name) :
+        m_field_name(field_name.c_str()),
+        m_handled(false)
+    {
+    }
+
+    detail::dispatch_rule operator<<(const char* field_name);
+    detail::dispatch_rule operator<<(const std::string& field_name);
+}; // class dispatch
+
+namespace detail
+{
+
+class dispatch_rule
+{
+private:
+
+    dispatch& m_dispatch;
+    const char* m_field_name;
+
+public:
+
+    explicit dispatch_rule(dispatch& parent_dispatch, const char* field_name) :
+        m_dispatch(parent_dispatch),
+        m_field_name(field_name)
+    {
+    }
+
+    template<typename Handler>
+    dispatch& operator>>(Handler handler) const
+    {
+        if (!m_dispatch.m_handled && ((m_field_name == NULL) || (strcmp(m_dispatch.m_field_name, m_field_name) == 0)))
+        {
+            handler();
+            m_dispatch.m_handled = true;
+        }
+
+        return m_dispatch;
+    }
+}; // class dispatch_rule
+
+// what the skipper knows about the bytes it has seen so far
+struct skip_state
+{
+    size_t depth; // of the brackets outside strings
+    bool in_string;
+    bool escaped; // the next byte is escaped
+};
+
+// returns true if c is the bracket that closes the skipped object or array
+inline bool skip_byte(skip_state& state, char c)
+{
+    if (state.escaped)
+    {
+        state.escaped = false;
+    }
+    else if (c == '\\')
+    {
+        state.escaped = true;
+    }
+    else if (c == '"')
+    {
+        state.in_string = !state.in_string;
+    }
+    else if (!state.in_string)
+    {
+        switch (c)
+        {
+        case '{': case '[': state.depth++; break;
+        case '}': case ']': return (--state.depth == 0);
+        }
+    }
+
+    return false;
+}
+
+// returns the position of the bracket that closes the skipped object or array in the
+// 64-byte block, or 64 if there is none
+inline size_t skip_block(skip_state& state, const char* block)
+{
+    const bracket_classes classes = classify_brackets(block);
+
+    uint64_t escaped_carry = state.escaped ? 1 : 0;
+    const uint64_t escaped = find_escaped(classes.backslashes, escaped_carry);
+    const uint64_t quotes = classes.quotes & ~escaped;
+    const uint64_t in_string = prefix_xor(quotes) ^ (state.in_string ? ~static_cast<uint64_t>(0) : 0);
+    const uint64_t opening = classes.opening & ~in_string & ~escaped; // like skip_byte, which ignores escaped bytes
+    const uint64_t closing = classes.closing & ~in_string & ~escaped;
+
+    const size_t closing_count = count_ones(closing);
+    if (closing_count < state.depth) // the depth can't drop to zero within the block
+    {
+        state.depth = state.depth + count_ones(opening) - closing_count;
+    }
+    else
+    {
+        for (uint64_t brackets = opening | closing; brackets != 0; brackets &= brackets - 1)
+        {
+            const size_t position = count_trailing_zeros(brackets);
+            if ((opening >> position) & 1)
+            {
+                state.depth++;
+            }
+            else if (--state.depth == 0)
+            {
+                return position;
+            }
+        }
+    }
+
+    state.escaped = (escaped_carry != 0);
+    state.in_string = ((in_string >> 63) != 0);
+
+    return 64;
+}
+
+// Consumes the input up to the bracket that closes the skipped object or array, and returns it
+// (or 0 if the input ends first). Only brackets and strings are looked at: nothing is written to
+// the write buffer, decoded or validated.
+template<typename Context>
+char skip_nested(Context& context, skip_state& state, const void*)
+{
+    char c;
+    while ((c = context.read()) != 0)
+    {
+        if (skip_byte(state, c))
+        {
+            return c;
+        }
+    }
+
+    return 0;
+}
+
+template<typename Context>
+char skip_nested(Context& context, skip_state& state, const windowed_context*)
+{
+    for (;;)
+    {
+        const char* const window = context.read_window();
+        const size_t size = context.read_window_size();
+
+        size_t i = 0;
+        for (; size - i >= 64; i += 64)
+        {
+            const size_t position = skip_block(state, window + i);
+            if (position < 64)
+            {
+                context.consume(i + position + 1);
+                return window[i + position];
+            }
+        }
+
+        for (; i < size; i++)
+        {
+            if (skip_byte(state, window[i]))
+            {
+                context.consume(i + 1);
+                return window[i];
+            }
+        }
+
+        context.consume(size);
+
+        // streams refill their window here
+        const char c = context.read();
+        if ((c == 0) || skip_byte(state, c))
+        {
+            return c;
+        }
+    }
+}
+
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+
+// jumps to the matching closing bracket if the context has a structural index
+template<typename Context>
+char skip_nested(Context& context, skip_state& state, const indexed_context*)
+{
+    const structural_index* const index = context.index();
+    if (index != NULL)
+    {
+        const size_t opening = context.read_offset() - 1;
+        const size_t token = context.next_token(opening);
+        const size_t closing = ((token < index->size()) && (index->offset(token) == opening)) ? index->closing(token) : 0;
+        if (closing != 0)
+        {
+            context.consume(index->offset(closing) + 1 - context.read_offset());
+
+            return context.read_window()[-1];
+        }
+    }
+
+    return skip_nested(context, state, static_cast<const windowed_context*>(&context));
+}
+
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
+
+// skips the object or array whose opening bracket was just read
+template<typename Context>
+bool try_skip_nested(Context& context, char opening)
+{
+    skip_state state = { 1, false, false };
+    const char closing = skip_nested(context, state, &context);
+    if (closing == 0)
+    {
+        return fail(context, state.in_string ? parse_error::EXPECTED_CLOSING_QUOTE : parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    }
+    else if (closing != opening + 2) // { and } (and [ and ]) are two code points apart
+    {
+        return fail(context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    }
+
+    return true;
+}
+
+// Consumes the input up to the closing quote of the string whose opening quote was just read,
+// and returns false if the input ends first. Nothing is written, decoded or validated.
+template<typename Context>
+bool skip_string(Context& context, const void*)
+{
+    bool escaped = false;
+    char c;
+    while ((c = context.read()) != 0)
+    {
+        if (escaped)
+        {
+            escaped = false;
+        }
+        else if (c == '\\')
+        {
+            escaped = true;
+        }
+        else if (c == '"')
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template<typename Context>
+bool skip_string(Context& context, const windowed_context*)
+{
+    for (;;)
+    {
+        const char* const window = context.read_window();
+        context.consume(find_string_special(window, window + context.read_window_size()) - window);
+
+        // streams refill their window here
+        const char c = context.read();
+        if (c == '"')
+        {
+            return true;
+        }
+        else if ((c == 0) || ((c == '\\') && (context.read() == 0)))
+        {
+            return false;
+        }
+    }
+}
+
+template<typename Context>
+bool try_skip_string(Context& context)
+{
+    if (!skip_string(context, &context))
+    {
+        return fail(context, parse_error::EXPECTED_CLOSING_QUOTE);
+    }
+
+    return true;
+}
+
+// skips the nested object or array whose opening bracket was just read
+template<typename Context>
+bool try_skip_nested(Context& context)
+{
+    const char opening = (context.nested_status() == Context::NESTED_STATUS_OBJECT) ? '{' : '[';
+    context.reset_nested_status();
+
+    if (!try_skip_nested(context, opening))
+    {
+        return false;
+    }
+
+    context.end_nested();
+
+    return true;
+}
+
+template<typename Context>
+class ignore
+{
+    Context& m_context;
+
+public:
+
+    explicit ignore(Context& context) :
+        m_context(context)
+    {
+    }
+
+    void operator()(const char*, value)
+    {
+        operator()();
+    }
+
+    void operator()(value)
+    {
+        operator()();
+    }
+
+    void operator()() const
+    {
+        if (m_context.nested_status() != Context::NESTED_STATUS_NONE)
+        {
+            try_skip_nested(m_context);
+        }
+    }
+}; // class ignore
+
+// calls the wrapped handler, then ignores the nested object or array it did not parse (if any)
+template<typename Context, typename Handler>
+class ignore_unparsed
+{
+    Context& m_context;
+    Handler m_handler;
+
+    void ignore_rest()
+    {
+        if (!m_context.status().failed() && (m_context.nested_status() != Context::NESTED_STATUS_NONE))
+        {
+            try_skip_nested(m_context);
+        }
+    }
+
+public:
+
+    explicit ignore_unparsed(Context& context, const Handler& handler) :
+        m_context(context),
+        m_handler(handler)
+    {
+    }
+
+    void operator()(const char* name, value v)
+    {
+        m_handler(name, v);
+        ignore_rest();
+    }
+
+    void operator()(const key& name, value v)
+    {
+        call_field_handler(m_handler, name, v);
+        ignore_rest();
+    }
+
+    void operator()(value v)
+    {
+        m_handler(v);
+        ignore_rest();
+    }
+}; // class ignore_unparsed
+
+// ignore_unparsed forwards the key to the wrapped handler if it takes one
+template<typename Context, typename Handler>
+struct takes_key<ignore_unparsed<Context, Handler>, void>
+{
+    enum { value = takes_key<Handler>::value };
+};
+
+} // namespace detail
+
+inline detail::dispatch_rule dispatch::operator<<(const char* field_name)
+{
+    return detail::dispatch_rule(*this, field_name);
+}
+
+inline detail::dispatch_rule dispatch::operator<<(const std::string& field_name)
+{
+    return operator<<(field_name.c_str());
+}
+
+static const char* const any = NULL;
+
+template<typename Context>
+parse_status try_ignore(Context& context)
+{
+    detail::ignore<Context> ignore(context);
+    ignore();
+
+    return context.status();
+}
+
+template<typename Context>
+void ignore(Context& context)
+{
+    const parse_status status = try_ignore(context);
+    if (status.failed())
+    {
+        throw status.error();
+    }
+}
+
+// Wraps a handler of parse_object or parse_array (or of their try_ variants), so that the nested
+// objects and arrays it does not parse are ignored instead of making parsing fail
+template<typename Context, typename Handler>
+detail::ignore_unparsed<Context, Handler> ignore_unparsed(Context& context, Handler handler)
+{
+    return detail::ignore_unparsed<Context, Handler>(context, handler);
+}
+
+// A parser for messages that arrive in chunks, e.g. from a non-blocking socket. Every chunk is
+// passed to feed() as soon as it is received, and the parser saves its state where the chunk ends
+// (even in the middle of a string or of an escape sequence), to resume from there with the next one.
+// The handler is called for the fields and the elements of the message and of all its nested objects
+// and arrays, in order, with the same arguments as the handlers of parse_object and parse_array,
+// so it must accept both (const char* name, value) and (value). Nested objects and arrays are parsed
+// automatically: their fields or elements follow the value announcing them, with a nesting_level()
+// one higher. Unlike parse_object and parse_array, names and values are only valid until the handler
+// returns.
+template<typename Handler>
+class push_parser : detail::noncopyable
+{
+private:
+
+    enum state
+    {
+        MESSAGE, // before the opening bracket of the message
+        VALUE,
+        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
+        FIELD_NAME,
+        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
+        COLON,
+        COMMA_OR_CLOSING_BRACKET,
+        STRING,
+        ESCAPE_SEQUENCE,
+        UTF16_SEQUENCE,
+        UNQUOTED_VALUE,
+        END
+    };
+
+    Handler m_handler;
+    state m_state;
+    std::vector<char> m_brackets; // the opening brackets of the objects and arrays being parsed
+    std::vector<char> m_name; // the name of the current field
+    std::vector<char> m_buffer; // the current string or unquoted value
+    bool m_reading_name; // m_name is being read, rather than m_buffer
+    char m_utf16_seq[detail::UTF16_ESCAPE_SEQ_LENGTH + 1];
+    size_t m_utf16_seq_length;
+    uint16_t m_high_surrogate;
+    size_t m_offset; // of the first byte of the next chunk
+    parse_status m_status;
+
+    std::vector<char>& string_buffer()
+    {
+        return m_reading_name ? m_name : m_buffer;
+    }
+
+    void emit(const value& v)
+    {
+        if (m_brackets.back() == '{')
+        {
+            m_handler(&m_name[0], v);
+        }
+        else
+        {
+            m_handler(v);
+        }
+    }
+
+    bool open(char bracket)
+    {
+        if (m_brackets.size() > MJR_NESTING_LIMIT)
+        {
+            return false;
+        }
+
+        m_brackets.push_back(bracket);
+        m_state = (bracket == '{') ? FIELD_NAME_OR_CLOSING_BRACKET : VALUE_OR_CLOSING_BRACKET;
+
+        return true;
+    }
+
+    void close()
+    {
+        m_brackets.pop_back();
+        m_state = m_brackets.empty() ? END : COMMA_OR_CLOSING_BRACKET;
+    }
+
+    // the code unit in m_utf16_seq, appended to the string being read
+    bool read_utf16_escape_sequence()
+    {
+        uint16_t code_unit;
+        detail::utf8_char utf8;
+
+        if (!detail::parse_utf16_escape_sequence(m_utf16_seq, code_unit))
+        {
+            return false;
+        }
+
+        if (m_high_surrogate != 0)
+        {
+            // we were waiting for the low surrogate (that now is code_unit)
+            if (!detail::utf16_to_utf8(m_high_surrogate, code_unit, utf8))
+            {
+                return false;
+            }
+            m_high_surrogate = 0;
+        }
+        else if (code_unit >= 0xD800 && code_unit <= 0xDBFF)
+        {
+            m_high_surrogate = code_unit;
+            return true;
+        }
+        else if (!detail::utf16_to_utf8(code_unit, 0, utf8))
+        {
+            return false;
+        }
+
+        std::vector<char>& buffer = string_buffer();
+        for (size_t i = 0; i < sizeof(utf8.bytes); i++)
+        {
+            if ((i > 0) && (utf8[i] == 0))
+            {
+                break;
+            }
+
+            buffer.push_back(static_cast<char>(utf8[i]));
+        }
+
+        return true;
+    }
+
+    // parses [begin, end) until the message ends or an error occurs, returns where it stopped
+    const char* parse(const char* begin, const char* end, parse_error::error_reason& error)
+    {
+        const char* p = begin;
+
+        while ((p != end) && (m_state != END))
+        {
+            if (m_state < STRING) // between tokens
+            {
+                p = detail::find_non_whitespace(p, end);
+                if (p == end)
+                {
+                    break;
+                }
+                if (isspace(*p)) // \v and \f
+                {
+                    p++;
+                    continue;
+                }
+            }
+
+            const char c = *p;
+
+            switch (m_state)
+            {
+            case MESSAGE:
+                if ((c != '{') && (c != '['))
+                {
+                    error = parse_error::EXPECTED_OPENING_BRACKET;
+                    return p;
+                }
+                open(c);
+                p++;
+                break;
+
+            case VALUE_OR_CLOSING_BRACKET:
+                if (c == ']')
+                {
+                    close();
+                    p++;
+                    break;
+                }
+                // intentional fall-through
+
+            case VALUE:
+                if (c == '"')
+                {
+                    m_buffer.clear();
+                    m_reading_name = false;
+                    m_state = STRING;
+                    p++;
+                }
+                else if ((c == '{') || (c == '['))
+                {
+                    emit(value((c == '{') ? Object : Array));
+                    if (!open(c))
+                    {
+                        error = parse_error::EXCEEDED_NESTING_LIMIT;
+                        return p;
+                    }
+                    p++;
+                }
+                else if ((c == ',') || (c == '}') || (c == ']'))
+                {
+                    error = parse_error::INVALID_VALUE;
+                    return p;
+                }
+                else
+                {
+                    m_buffer.clear();
+                    m_state = UNQUOTED_VALUE;
+                }
+                break;
+
+            case FIELD_NAME_OR_CLOSING_BRACKET:
+                if (c == '}')
+                {
+                    close();
+                    p++;
+                    break;
+                }
+                // intentional fall-through
+
+            case FIELD_NAME:
+                if (c != '"')
+                {
+                    error = parse_error::EXPECTED_OPENING_QUOTE;
+                    return p;
+                }
+                m_name.clear();
+                m_reading_name = true;
+                m_state = STRING;
+                p++;
+                break;
+
+            case COLON:
+                if (c != ':')
+                {
+                    error = parse_error::EXPECTED_COLON;
+                    return p;
+                }
+                m_state = VALUE;
+                p++;
+                break;
+
+            case COMMA_OR_CLOSING_BRACKET:
+                if (c == ',')
+                {
+                    m_state = (m_brackets.back() == '{') ? FIELD_NAME : VALUE;
+                }
+                else if (c == m_brackets.back() + 2) // { and } (and [ and ]) are two code points apart
+                {
+                    close();
+                }
+                else
+                {
+                    error = parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET;
+                    return p;
+                }
+                p++;
+                break;
+
+            case STRING:
+                {
+                    // copy everything up to the next quote, escape or control character in one go
+                    const char* const run_end = detail::find_string_special(p, end);
+                    if (run_end != p)
+                    {
+                        if (m_high_surrogate != 0)
+                        {
+                            error = parse_error::EXPECTED_UTF16_LOW_SURROGATE;
+                            return p;
+                        }
+                        string_buffer().insert(string_buffer().end(), p, run_end);
+                        p = run_end;
+                        break;
+                    }
+
+                    if (c == '\\')
+                    {
+                        m_state = ESCAPE_SEQUENCE;
+                    }
+                    else if (m_high_surrogate != 0)
+                    {
+                        error = parse_error::EXPECTED_UTF16_LOW_SURROGATE;
+                        return p;
+                    }
+                    else if (c == '"')
+                    {
+                        string_buffer().push_back(0);
+                        if (m_reading_name)
+                        {
+                            m_state = COLON;
+                        }
+                        else
+                        {
+                            emit(value(String, &m_buffer[0]));
+                            m_state = COMMA_OR_CLOSING_BRACKET;
+                        }
+                    }
+                    else
+                    {
+                        string_buffer().push_back(c);
+                    }
+                    p++;
+                }
+                break;
+
+            case ESCAPE_SEQUENCE:
+                m_state = STRING;
+
+                if ((m_high_surrogate != 0) && (c != 'u'))
+                {
+                    error = parse_error::EXPECTED_UTF16_LOW_SURROGATE;
+                    return p + 1; // the pull parser reads the escaped character before failing
+                }
+
+                switch (c)
+                {
+                case '"': string_buffer().push_back('"'); break;
+                case '\\': string_buffer().push_back('\\'); break;
+                case '/': string_buffer().push_back('/'); break;
+                case 'b': string_buffer().push_back('\b'); break;
+                case 'f': string_buffer().push_back('\f'); break;
+                case 'n': string_buffer().push_back('\n'); break;
+                case 'r': string_buffer().push_back('\r'); break;
+                case 't': string_buffer().push_back('\t'); break;
+                case 'u': m_state = UTF16_SEQUENCE; m_utf16_seq_length = 0; break;
+                default:
+                    error = parse_error::INVALID_ESCAPE_SEQUENCE;
+                    return p;
+                }
+                p++;
+                break;
+
+            case UTF16_SEQUENCE:
+                m_utf16_seq[m_utf16_seq_length++] = c;
+                if (m_utf16_seq_length == detail::UTF16_ESCAPE_SEQ_LENGTH)
+                {
+                    if (!read_utf16_escape_sequence())
+                    {
+                        error = parse_error::INVALID_UTF16_CHARACTER;
+                        return p;
+                    }
+                    m_state = STRING;
+                }
+                p++;
+                break;
+
+            case UNQUOTED_VALUE:
+                {
+                    const char* run_end = p;
+                    while ((run_end != end) && (*run_end != ',') && (*run_end != '}') && (*run_end != ']') && !isspace(*run_end))
+                    {
+                        run_end++;
+                    }
+                    m_buffer.insert(m_buffer.end(), p, run_end);
+                    p = run_end;
+
+                    if (p != end) // the value is complete, the terminator is parsed in the next state
+                    {
+                        const size_t length = m_buffer.size();
+                        m_buffer.push_back(0);
+
+                        value v;
+                        if (!detail::classify_unquoted_value(&m_buffer[0], length, v))
+                        {
+                            error = parse_error::INVALID_VALUE;
+                            return p;
+                        }
+                        emit(v);
+                        m_state = COMMA_OR_CLOSING_BRACKET;
+                    }
+                }
+                break;
+
+            case END:
+
+                throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
             }
         }
+
+        return p;
+    }
+
+public:
+
+    explicit push_parser(Handler handler) :
+        m_handler(handler),
+        m_state(MESSAGE),
+        m_reading_name(false),
+        m_utf16_seq_length(0),
+        m_high_surrogate(0),
+        m_offset(0)
+    {
+        std::fill_n(m_utf16_seq, sizeof(m_utf16_seq), 0);
+    }
+
+    // Parses the next chunk of the message, calling the handler for the fields and elements it
+    // completes. Returns the number of bytes consumed, which is less than size only if the message
+    // ends within the chunk. Throws parse_error if the message is invalid, after which the parser
+    // cannot be used any more.
+    size_t feed(const char* data, size_t size)
+    {
+        size_t consumed;
+        const parse_status status = try_feed(data, size, consumed);
+        if (status.failed())
+        {
+            throw status.error();
+        }
+
+        return consumed;
+    }
+
+    // same as feed, but errors are returned instead of being thrown
+    parse_status try_feed(const char* data, size_t size, size_t& consumed)
+    {
+        consumed = 0;
+        if (m_status.failed())
+        {
+            return m_status;
+        }
+
+        parse_error::error_reason error = parse_error::UNKNOWN;
+        const char* const stop = parse(data, data + size, error);
+        if (error != parse_error::UNKNOWN)
+        {
+            m_status = parse_status(parse_error(error, m_offset + (stop - data)));
+            return m_status;
+        }
+
+        consumed = stop - data;
+        m_offset += consumed;
+
+        return m_status;
+    }
+
+    // true once the whole message has been parsed
+    bool done() const
+    {
+        return m_state == END;
+    }
+
+    // while the handler is called, 1 for the fields or elements of the message,
+    // 2 for those of its nested objects and arrays, and so on
+    size_t nesting_level() const
+    {
+        return m_brackets.size();
+    }
+
+    // the number of bytes consumed so far
+    size_t offset() const
+    {
+        return m_offset;
+    }
+}; // class push_parser
+
+enum event_type
+{
+    BeginObject,
+    EndObject,
+    BeginArray,
+    EndArray,
+    Key,
+    Scalar
 };
 
+// A step of the parsing of a message: the name of a field for Key events, a value that is not
+// an object or an array for Scalar events. Both are valid until the context is destroyed, like
+// those passed to the handlers of parse_object and parse_array.
+struct event
+{
+    event_type type;
+    const char* name;
+    minijson::value scalar;
 
-class value MJR_FINAL
+    event() :
+        type(Scalar),
+        name("")
+    {
+    }
+};
+
+namespace detail
+{
+
+// Parses a message one event at a time, without recursion: the opening brackets of the objects
+// and arrays being parsed are kept in a fixed-size array, so no memory is allocated.
+template<typename Context>
+class event_reader : noncopyable
 {
 private:
 
-    value_type m_type;
-    const char* m_buffer;
-    long m_long_value;
-    double m_double_value;
+    enum state
+    {
+        MESSAGE, // before the opening bracket of the message
+        VALUE,
+        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
+        FIELD_NAME,
+        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
+        COLON,
+        COMMA_OR_CLOSING_BRACKET,
+        END
+    };
 
-public:
+    Context& m_context;
+    state m_state;
+    char m_brackets[MJR_NESTING_LIMIT + 1]; // the opening brackets of the objects and arrays being parsed
+    size_t m_depth;
+    size_t m_nesting_level; // of the message, if it is nested in an object or array parsed by parse_object or parse_array
+    char m_next_char; // the character that terminated the last unquoted value, if any
 
-    explicit value(value_type type = Null, const char* buffer = "", long long_value = 0, double double_value = 0.0) :
-        m_type(type),
-        m_buffer(buffer),
-        m_long_value(long_value),
-        m_double_value(double_value)
+    bool open(char c, event& result)
     {
+        if (m_nesting_level + m_depth > MJR_NESTING_LIMIT)
+        {
+            return fail(m_context, parse_error::EXCEEDED_NESTING_LIMIT);
+        }
+
+        m_brackets[m_depth++] = c;
+        m_state = (c == '{') ? FIELD_NAME_OR_CLOSING_BRACKET : VALUE_OR_CLOSING_BRACKET;
+        result.type = (c == '{') ? BeginObject : BeginArray;
+
+        return true;
     }
 
-    value_type type() const
+    bool close(event& result)
     {
-        return m_type;
+        result.type = (m_brackets[--m_depth] == '{') ? EndObject : EndArray;
+        m_state = COMMA_OR_CLOSING_BRACKET;
+        if (m_depth == 0)
+        {
+            m_state = END;
+            m_context.end_nested();
+        }
+
+        return true;
     }
 
-    const char* as_string() const
+public:
+
+    // if called from a handler of parse_object or parse_array, reads the nested object or array
+    explicit event_reader(Context& context) :
+        m_context(context),
+        m_state(MESSAGE),
+        m_depth(0),
+        m_nesting_level(context.nesting_level()),
+        m_next_char(0)
     {
-        return m_buffer;
+        bool must_read;
+        parse_init_helper(context, m_next_char, must_read);
+        context.reset_nested_status();
     }
 
-    long as_long() const
+    // the number of objects and arrays being parsed
+    size_t depth() const
     {
-        return m_long_value;
+        return m_depth;
     }
 
-    bool as_bool() const
-    {
-        return (m_long_value) ? true : false; // to avoid VS2013 warnings
-    }
+    // Reads the next event. Returns false after the end of the message, or if parsing fails,
+    // in which case the error is recorded in the context.
+    bool next(event& result)
+    {
+        for (;;)
+        {
+            char c = m_next_char;
+            m_next_char = 0;
+            if (c == 0)
+            {
+                if ((m_state == END) || m_context.status().failed())
+                {
+                    return false;
+                }
+
+                skip_whitespace(m_context, &m_context);
+                c = m_context.read();
+            }
+
+            if (isspace(c))
+            {
+                continue;
+            }
+
+            switch (m_state)
+            {
+            case MESSAGE:
+                if ((c != '{') && (c != '['))
+                {
+                    return fail(m_context, parse_error::EXPECTED_OPENING_BRACKET);
+                }
+                return open(c, result);
+
+            case FIELD_NAME_OR_CLOSING_BRACKET:
+                if (c == '}')
+                {
+                    return close(result);
+                }
+                // intentional fall-through
+
+            case FIELD_NAME:
+                if (c != '"')
+                {
+                    return fail(m_context, parse_error::EXPECTED_OPENING_QUOTE);
+                }
+                m_context.new_write_buffer();
+                if (!try_read_quoted_string(m_context, true))
+                {
+                    return false;
+                }
+                result.type = Key;
+                result.name = m_context.write_buffer();
+                m_state = COLON;
+                return true;
+
+            case COLON:
+                if (c != ':')
+                {
+                    return fail(m_context, parse_error::EXPECTED_COLON);
+                }
+                m_state = VALUE;
+                break;
+
+            case VALUE_OR_CLOSING_BRACKET:
+                if (c == ']')
+                {
+                    return close(result);
+                }
+                // intentional fall-through
+
+            case VALUE:
+                if ((c == '{') || (c == '['))
+                {
+                    return open(c, result);
+                }
+                else
+                {
+                    std::pair<value, char> read_value_result;
+                    if (!try_read_value(m_context, c, read_value_result))
+                    {
+                        return false;
+                    }
+                    result.type = Scalar;
+                    result.scalar = read_value_result.first;
+                    m_next_char = read_value_result.second;
+                    m_state = COMMA_OR_CLOSING_BRACKET;
+                    return true;
+                }
+
+            case COMMA_OR_CLOSING_BRACKET:
+                if (c == ',')
+                {
+                    m_state = (m_brackets[m_depth - 1] == '{') ? FIELD_NAME : VALUE;
+                }
+                else if (c == m_brackets[m_depth - 1] + 2) // { and } (and [ and ]) are two code points apart
+                {
+                    return close(result);
+                }
+                else
+                {
+                    return fail(m_context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+                }
+                break;
+
+            case END:
 
-    double as_double() const
-    {
-        return m_double_value;
+                throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+            }
+        }
     }
-}; // class value
+}; // class event_reader
 
-namespace detail
-{
+} // namespace detail
 
+// Walks a message imperatively, instead of through handlers: the cursor is on a value (at first,
+// the message itself), that can be read with value(), skipped with skip(), or entered with enter()
+// if it is an object or an array. next() then moves to its fields or elements, one at a time, and
+// returns false at the end, where the cursor is back in the enclosing object or array.
+// Names and values are valid until the context is destroyed, errors are thrown as parse_error.
 template<typename Context>
-value parse_unquoted_value(const Context& context)
+class cursor : detail::noncopyable
 {
-    const char* const buffer = context.write_buffer();
+private:
 
-    if (strcmp(buffer, "true") == 0)
+    Context& m_context;
+    char m_brackets[MJR_NESTING_LIMIT + 1]; // the opening brackets of the entered objects and arrays
+    size_t m_depth;
+    size_t m_nesting_level; // of the message, if it is nested in an object or array parsed by parse_object or parse_array
+    char m_next_char; // the character after the last value read, if any, or the first one of the current value
+    bool m_on_value; // true if the current value has not been read, skipped, or entered yet
+    bool m_first; // true until next() is called in the current object or array
+    const char* m_key;
+
+    void check(bool succeeded) const
     {
-        return value(Boolean, buffer, 1, 1.0);
+        if (!succeeded)
+        {
+            detail::throw_error(m_context);
+        }
     }
-    else if (strcmp(buffer, "false") == 0)
+
+    void error(parse_error::error_reason reason)
     {
-        return value(Boolean, buffer, 0, 0.0);
+        detail::fail(m_context, reason);
+        detail::throw_error(m_context);
     }
-    else if (strcmp(buffer, "null") == 0)
+
+    void check_on_value() const
     {
-        return value(Null, buffer, 0, 0.0);
+        if (!m_on_value)
+        {
+            throw std::logic_error("The cursor is not on a value");
+        }
     }
-    else
-    {
-        long long_value = 0;
-        double double_value = 0.0;
 
-        try
+    char peek()
+    {
+        if (isspace(m_next_char))
         {
-            long_value = parse_long(buffer);
-            double_value = long_value;
+            m_next_char = 0;
         }
-        catch (const number_parse_error&)
+
+        if (m_next_char == 0)
         {
-            try
+            do
             {
-                double_value = parse_double(buffer);
-            }
-            catch (const number_parse_error&)
-            {
-                throw parse_error(context, parse_error::INVALID_VALUE);
+                detail::skip_whitespace(m_context, &m_context);
+                m_next_char = m_context.read();
             }
+            while (isspace(m_next_char));
         }
 
-        return value(Number, buffer, long_value, double_value);
+        return m_next_char;
     }
-}
 
-template<typename Context>
-std::pair<value, char> read_value(Context& context, char first_char)
-{
-    if (first_char == '{')
-    {
-        return std::make_pair(value(Object), 0);
-    }
-    else if (first_char == '[')
-    {
-        return std::make_pair(value(Array), 0);
-    }
-    else if (first_char == '"') // quoted string
+    char read()
     {
-        context.new_write_buffer();
-        read_quoted_string(context, true);
+        const char c = peek();
+        m_next_char = 0;
 
-        return std::make_pair(value(String, context.write_buffer()), 0);
+        return c;
     }
-    else // unquoted value
+
+    bool close(char c)
     {
-        context.new_write_buffer();
-        const char ending_char = read_unquoted_value(context, first_char);
+        if (c != m_brackets[m_depth - 1] + 2) // { and } (and [ and ]) are two code points apart
+        {
+            return false;
+        }
 
-        return std::make_pair(parse_unquoted_value(context), ending_char);
-    }
-}
+        m_depth--;
+        m_first = false;
+        if (m_depth == 0)
+        {
+            m_context.end_nested();
+        }
 
-template<typename Context>
-void parse_init_helper(const Context& context, char& c, bool& must_read)
-{
-    switch (context.nested_status())
-    {
-    case Context::NESTED_STATUS_NONE:
-        c = 0;
-        must_read = true;
-        break;
-    case Context::NESTED_STATUS_OBJECT:
-        c = '{';
-        must_read = false;
-        break;
-    case Context::NESTED_STATUS_ARRAY:
-        c = '[';
-        must_read = false;
-        break;
+        return true;
     }
-}
 
-template<typename Context>
-value parse_value_helper(Context& context, char& c, bool& must_read)
-{
-    const std::pair<value, char> read_value_result = detail::read_value(context, c);
-    const value v = read_value_result.first;
+public:
 
-    if (v.type() == Object)
+    // if created by a handler of parse_object or parse_array, walks the nested object or array
+    explicit cursor(Context& context) :
+        m_context(context),
+        m_depth(0),
+        m_nesting_level(context.nesting_level()),
+        m_next_char(0),
+        m_on_value(true),
+        m_first(false),
+        m_key("")
     {
-        context.begin_nested(Context::NESTED_STATUS_OBJECT);
+        bool must_read;
+        detail::parse_init_helper(context, m_next_char, must_read);
+        context.reset_nested_status();
     }
-    else if (v.type() == Array)
+
+    // the number of objects and arrays entered and not left yet
+    size_t depth() const
     {
-        context.begin_nested(Context::NESTED_STATUS_ARRAY);
+        return m_depth;
     }
-    else if (v.type() != String)
+
+    // the name of the current field, if the cursor is in an object
+    const char* key() const
     {
-        c = read_value_result.second;
-        must_read = false;
+        return m_key;
     }
 
-    return v;
-}
+    // the type of the current value, guessed from its first character: reading it may still fail
+    value_type peek_type()
+    {
+        check_on_value();
 
-} // namespace detail
+        switch (peek())
+        {
+        case '{':
+            return Object;
+        case '[':
+            return Array;
+        case '"':
+            return String;
+        case 't':
+        case 'f':
+            return Boolean;
+        case 'n':
+            return Null;
+        default:
+            return Number;
+        }
+    }
 
-template<typename Context, typename Handler>
-void parse_object(Context& context, Handler handler)
-{
-    const size_t nesting_level = context.nesting_level();
-    if (nesting_level > MJR_NESTING_LIMIT)
+    // reads the current value; objects and arrays are skipped
+    minijson::value value()
     {
-        throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
-    }
+        check_on_value();
 
-    char c = 0;
-    bool must_read = false;
+        const value_type type = peek_type();
+        if ((type == Object) || (type == Array))
+        {
+            skip();
+            return minijson::value(type);
+        }
 
-    parse_init_helper(context, c, must_read);
-    context.reset_nested_status();
+        m_on_value = false;
+        std::pair<minijson::value, char> result;
+        check(detail::try_read_value(m_context, read(), result));
+        m_next_char = result.second;
 
-    enum
+        return result.first;
+    }
+
+    // skips the current value, without decoding it if it is a string, an object or an array
+    void skip()
     {
-        OPENING_BRACKET,
-        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
-        FIELD_NAME,
-        COLON,
-        FIELD_VALUE,
-        COMMA_OR_CLOSING_BRACKET,
-        END
-    } state = OPENING_BRACKET;
+        check_on_value();
 
-    const char* field_name = "";
+        m_on_value = false;
+        const char c = read();
+        if ((c == '{') || (c == '['))
+        {
+            check(detail::try_skip_nested(m_context, c));
+        }
+        else if (c == '"')
+        {
+            check(detail::try_skip_string(m_context));
+        }
+        else
+        {
+            std::pair<minijson::value, char> result;
+            check(detail::try_read_value(m_context, c, result));
+            m_next_char = result.second;
+        }
+    }
 
-    while (state != END)
+    // enters the current value, which must be an object or an array
+    void enter()
     {
-        if (context.nesting_level() != nesting_level)
+        check_on_value();
+
+        m_on_value = false;
+        const char c = read();
+        if ((c != '{') && (c != '['))
         {
-            throw parse_error(context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+            error(parse_error::EXPECTED_OPENING_BRACKET);
         }
-
-        if (must_read)
+        if (m_nesting_level + m_depth > MJR_NESTING_LIMIT)
         {
-            c = context.read();
+            error(parse_error::EXCEEDED_NESTING_LIMIT);
         }
 
-        must_read = true;
+        m_brackets[m_depth++] = c;
+        m_first = true;
+    }
 
-        if (isspace(c)) // skip whitespace
+    // moves to the next field or element of the current object or array, skipping the current
+    // value if needed, or leaves the object or array and returns false after the last one
+    bool next()
+    {
+        if (m_depth == 0)
         {
-            continue;
+            return false;
         }
-
-        switch (state)
+        if (m_on_value)
         {
-        case OPENING_BRACKET:
-            if (c != '{')
-            {
-                throw parse_error(context, parse_error::EXPECTED_OPENING_BRACKET);
-            }
-            state = FIELD_NAME_OR_CLOSING_BRACKET;
-            break;
+            skip();
+        }
 
-        case FIELD_NAME_OR_CLOSING_BRACKET:
-            if (c == '}')
+        char c = read();
+        if (m_first)
+        {
+            m_first = false;
+            if (close(c))
             {
-                state = END;
-                break;
+                return false;
             }
-            // intentional fall-through
+        }
+        else if (c == ',')
+        {
+            c = read();
+        }
+        else if (close(c))
+        {
+            return false;
+        }
+        else
+        {
+            error(parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+        }
 
-        case FIELD_NAME:
+        if (m_brackets[m_depth - 1] == '{')
+        {
             if (c != '"')
             {
-                throw parse_error(context, parse_error::EXPECTED_OPENING_QUOTE);
+                error(parse_error::EXPECTED_OPENING_QUOTE);
             }
-            context.new_write_buffer();
-            detail::read_quoted_string(context, true);
-            field_name = context.write_buffer();
-            state = COLON;
-            break;
+            m_context.new_write_buffer();
+            check(detail::try_read_quoted_string(m_context, true));
+            m_key = m_context.write_buffer();
 
-        case COLON:
-            if (c != ':')
+            if (read() != ':')
             {
-                throw parse_error(context, parse_error::EXPECTED_COLON);
+                error(parse_error::EXPECTED_COLON);
             }
-            state = FIELD_VALUE;
-            break;
+        }
+        else
+        {
+            m_next_char = c; // the first character of the element
+        }
 
-        case FIELD_VALUE:
-            handler(field_name, parse_value_helper(context, c, must_read));
-            state = COMMA_OR_CLOSING_BRACKET;
-            break;
+        m_on_value = true;
 
-        case COMMA_OR_CLOSING_BRACKET:
-            if (c == ',')
-            {
-                state = FIELD_NAME;
-            }
-            else if (c == '}')
+        return true;
+    }
+}; // class cursor
+
+namespace detail
+{
+
+// Reads the next segment of a JSON Pointer ("/a/b/3", with ~0 and ~1 standing for ~ and /)
+// or of a dotted path (".a.b[3]" or ".a.b.3"), and returns false at the end of the path.
+inline bool read_path_segment(const char*& path, std::string& segment)
+{
+    segment.clear();
+
+    switch (*path)
+    {
+    case 0:
+        return false;
+
+    case '/':
+        for (path++; (*path != 0) && (*path != '/'); path++)
+        {
+            if ((*path == '~') && ((path[1] == '0') || (path[1] == '1')))
             {
-                state = END;
+                segment += (*++path == '0') ? '~' : '/';
             }
             else
             {
-                throw parse_error(context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+                segment += *path;
             }
-            break;
+        }
+        return true;
 
-        case END:
+    case '[':
+        for (path++; (*path != 0) && (*path != ']'); path++)
+        {
+            segment += *path;
+        }
+        if (*path == ']')
+        {
+            path++;
+        }
+        return true;
 
-            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+    case '.':
+        path++;
+        if ((*path == 0) || (*path == '[')) // "." and ".[3]", as printed for arrays by nested_json::parser
+        {
+            return read_path_segment(path, segment);
         }
+        // intentional fall-through
 
-        if (c == 0)
+    default:
+        for (; (*path != 0) && (*path != '.') && (*path != '['); path++)
         {
-            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+            segment += *path;
         }
+        return true;
     }
-
-    context.end_nested();
 }
 
-template<typename Context, typename Handler>
-void parse_array(Context& context, Handler handler)
+// returns false if the segment is not a decimal array index that fits in a size_t
+inline bool parse_path_index(const std::string& segment, size_t& index)
 {
-    const size_t nesting_level = context.nesting_level();
-    if (nesting_level > MJR_NESTING_LIMIT)
+    if (segment.empty())
     {
-        throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
+        return false;
     }
 
-    char c = 0;
-    bool must_read = false;
+    index = 0;
+    for (size_t i = 0; i < segment.size(); i++)
+    {
+        if ((segment[i] < '0') || (segment[i] > '9'))
+        {
+            return false;
+        }
+        const size_t digit = segment[i] - '0';
+        if (index > (static_cast<size_t>(-1) - digit) / 10)
+        {
+            return false; // no array has that many elements
+        }
+        index = index * 10 + digit;
+    }
 
-    parse_init_helper(context, c, must_read);
-    context.reset_nested_status();
+    return true;
+}
 
-    enum
-    {
-        OPENING_BRACKET,
-        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
-        VALUE,
-        COMMA_OR_CLOSING_BRACKET,
-        END
-    } state = OPENING_BRACKET;
+} // namespace detail
 
-    while (state != END)
+// Looks up the value at the given path in the message read from the context, e.g. "/a/b/3" or
+// ".a.b[3]" ("" for the message itself), and returns false if there is none. The names of the
+// fields of the objects on the path are decoded to be compared, and the value found is decoded:
+// all the other values are skipped.
+// Objects and arrays can then be parsed with parse_object and parse_array, as if found by a handler.
+// Parsing stops right after the value found, or where the search failed.
+template<typename Context>
+bool find(Context& context, const char* path, value& result)
+{
+    cursor<Context> cursor(context);
+
+    std::string segment;
+    while (detail::read_path_segment(path, segment))
     {
-        if (context.nesting_level() != nesting_level)
+        const value_type type = cursor.peek_type();
+        bool found = false;
+        if (type == Object)
+        {
+            cursor.enter();
+            while (!found && cursor.next())
+            {
+                found = (segment.compare(cursor.key()) == 0);
+            }
+        }
+        else if (type == Array)
+        {
+            size_t index;
+            if (!detail::parse_path_index(segment, index))
+            {
+                return false;
+            }
+
+            cursor.enter();
+            for (size_t i = 0; !found && cursor.next(); i++)
+            {
+                found = (i == index);
+            }
+        }
+
+        if (!found)
         {
-            throw parse_error(context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+            return false;
         }
+    }
+
+    const value_type type = cursor.peek_type();
+    if ((type == Object) || (type == Array))
+    {
+        // the opening bracket has been read by peek_type()
+        context.begin_nested((type == Object) ? Context::NESTED_STATUS_OBJECT : Context::NESTED_STATUS_ARRAY);
+        result = value(type);
+    }
+    else
+    {
+        result = cursor.value();
+    }
+
+    return true;
+}
+
+// An immutable map from field names to slot numbers, built once and then shared (for instance
+// between threads) by all the messages with the same schema. Looking a field name up costs one
+// pass over the name plus, in general, a single comparison.
+class dispatch_table
+{
+public:
+
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+private:
+
+    struct entry
+    {
+        uint32_t hash;
+        size_t offset; // of the key in m_keys
+        size_t length;
+        size_t slot; // NOT_FOUND for empty entries
+    };
 
-        if (must_read)
+    std::vector<char> m_keys;
+    std::vector<entry> m_entries; // open addressing, at most half full
+    size_t m_size;
+
+    void build(const char* const* keys, size_t count)
+    {
+        size_t capacity = 4;
+        while (capacity < count * 2)
         {
-            c = context.read();
+            capacity *= 2;
         }
 
-        must_read = true;
+        const entry empty = { 0, 0, 0, NOT_FOUND };
+        m_entries.assign(capacity, empty);
 
-        if (isspace(c)) // skip whitespace
+        for (size_t slot = 0; slot < count; slot++)
         {
-            continue;
-        }
+            const size_t length = std::strlen(keys[slot]);
+            const uint32_t hash = detail::runtime_key_hash(keys[slot], length);
 
-        switch (state)
-        {
-        case OPENING_BRACKET:
-            if (c != '[')
+            if (find(keys[slot], length, hash) != NOT_FOUND) // duplicates: like in dispatch, the first one wins
             {
-                throw parse_error(context, parse_error::EXPECTED_OPENING_BRACKET);
+                continue;
             }
-            state = VALUE_OR_CLOSING_BRACKET;
-            break;
 
-        case VALUE_OR_CLOSING_BRACKET:
-            if (c == ']')
+            size_t i = hash & (capacity - 1);
+            while (m_entries[i].slot != NOT_FOUND)
             {
-                state = END;
-                break;
+                i = (i + 1) & (capacity - 1);
             }
-            // intentional fall-through
 
-        case VALUE:
-            handler(parse_value_helper(context, c, must_read));
-            state = COMMA_OR_CLOSING_BRACKET;
-            break;
+            const entry new_entry = { hash, m_keys.size(), length, slot };
+            m_entries[i] = new_entry;
+            m_keys.insert(m_keys.end(), keys[slot], keys[slot] + length);
+            m_size++;
+        }
+    }
 
-        case COMMA_OR_CLOSING_BRACKET:
-            if (c == ',')
-            {
-                state = VALUE;
-            }
-            else if (c == ']')
-            {
-                state = END;
-            }
-            else
+    size_t find(const char* field_name, size_t length, uint32_t hash) const
+    {
+        const size_t mask = m_entries.size() - 1;
+        for (size_t i = hash & mask; m_entries[i].slot != NOT_FOUND; i = (i + 1) & mask)
+        {
+            const entry& e = m_entries[i];
+            // m_keys is empty if all the keys are, and then &m_keys[0] is not valid
+            if ((e.hash == hash) && (e.length == length) && ((length == 0) || (std::memcmp(&m_keys[0] + e.offset, field_name, length) == 0)))
             {
-                throw parse_error(context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+                return e.slot;
             }
-            break;
+        }
 
-        case END:
+        return NOT_FOUND;
+    }
 
-            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
-        }
+public:
 
-        if (c == 0)
+    // the slot of keys[i] is i
+    explicit dispatch_table(const char* const* keys, size_t count) :
+        m_size(0)
+    {
+        build(keys, count);
+    }
+
+    template<size_t Count>
+    explicit dispatch_table(const char* const (&keys)[Count]) :
+        m_size(0)
+    {
+        build(keys, Count);
+    }
+
+    explicit dispatch_table(const std::vector<std::string>& keys) :
+        m_size(0)
+    {
+        std::vector<const char*> pointers(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
         {
-            throw std::runtime_error("This line should never be reached, please file a bug report"); // LCOV_EXCL_LINE
+            pointers[i] = keys[i].c_str();
         }
+
+        build(pointers.empty() ? NULL : &pointers[0], pointers.size());
     }
 
-    context.end_nested();
-}
+    // the number of distinct keys
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    // the slot of field_name, or NOT_FOUND
+    size_t find(const char* field_name) const
+    {
+        size_t length;
+        const uint32_t hash = detail::runtime_key_hash_and_length(field_name, length);
+
+        return find(field_name, length, hash);
+    }
+
+    size_t find(const std::string& field_name) const
+    {
+        return find(field_name.data(), field_name.size(), detail::runtime_key_hash(field_name.data(), field_name.size()));
+    }
+
+    // uses the hash of the key (in C++11 mode, the parser computes it while decoding the name)
+    size_t find(const key& field_name) const
+    {
+        return find(field_name.name(), field_name.length(), field_name.hash());
+    }
+}; // class dispatch_table
+
+#if MJR_CPP11_SUPPORTED
 
 namespace detail
 {
 
-class dispatch_rule; // forward declaration
+// same as runtime_key_hash, written as a single return statement so that it can be evaluated by the compiler
+constexpr uint32_t key_hash(const char* str, size_t length, uint32_t hash = KEY_HASH_OFFSET_BASIS)
+{
+    return (length == 0) ? hash : key_hash(str + 1, length - 1, (hash ^ static_cast<unsigned char>(*str)) * KEY_HASH_PRIME);
+}
+
+class static_dispatch_rule; // forward declaration
 
 } // namespace detail
 
-class dispatch : detail::noncopyable
+// A field name hashed at compile time, for static_dispatch: either a "name"_key literal
+// (see minijson::literals) or a constexpr static_key variable
+class static_key
 {
-    friend class detail::dispatch_rule;
+private:
+
+    const char* m_name;
+    size_t m_length;
+    uint32_t m_hash;
+
+public:
+
+    template<size_t Length>
+    constexpr explicit static_key(const char (&name)[Length]) :
+        m_name(name),
+        m_length(Length - 1),
+        m_hash(detail::key_hash(name, Length - 1))
+    {
+    }
+
+    constexpr static_key(const char* name, size_t length) :
+        m_name(name),
+        m_length(length),
+        m_hash(detail::key_hash(name, length))
+    {
+    }
+
+    constexpr const char* name() const
+    {
+        return m_name;
+    }
+
+    constexpr size_t length() const
+    {
+        return m_length;
+    }
+
+    constexpr uint32_t hash() const
+    {
+        return m_hash;
+    }
+}; // class static_key
+
+namespace literals
+{
+
+constexpr static_key operator"" _key(const char* name, size_t length)
+{
+    return static_key(name, length);
+}
+
+} // namespace literals
+
+// Same as dispatch, but the field name is hashed once, and every rule compares the hash of its key
+// (computed by the compiler) before comparing the strings, so that only the matching rule does so
+class static_dispatch : detail::noncopyable
+{
+    friend class detail::static_dispatch_rule;
 
 private:
 
     const char* m_field_name;
+    size_t m_length;
+    uint32_t m_hash;
     bool m_handled;
 
+    bool matches(const char* name, size_t length, uint32_t hash) const
+    {
+        return (hash == m_hash) && (length == m_length) && (std::memcmp(name, m_field_name, m_length) == 0);
+    }
+
 public:
 
-    explicit dispatch(const char* field_name) :
+    explicit static_dispatch(const char* field_name) :
         m_field_name(field_name),
+        m_length(std::strlen(field_name)),
+        m_hash(detail::runtime_key_hash(field_name, m_length)),
         m_handled(false)
     {
     }
 
-    explicit dispatch(const std::string& field_name) :
+    explicit static_dispatch(const std::string& field_name) :
         m_field_name(field_name.c_str()),
+        m_length(field_name.size()),
+        m_hash(detail::runtime_key_hash(field_name.data(), m_length)),
         m_handled(false)
     {
     }
 
-    detail::dispatch_rule operator<<(const char* field_name);
-    detail::dispatch_rule operator<<(const std::string& field_name);
-}; // class dispatch
+    // uses the hash the parser computed while decoding the name
+    explicit static_dispatch(const key& field_name) :
+        m_field_name(field_name.name()),
+        m_length(field_name.length()),
+        m_hash(field_name.hash()),
+        m_handled(false)
+    {
+    }
+
+    detail::static_dispatch_rule operator<<(const static_key& key);
+
+    // for minijson::any (or field names only known at run time)
+    template<typename Char>
+    detail::static_dispatch_rule operator<<(const Char* const& field_name);
+}; // class static_dispatch
 
 namespace detail
 {
 
-class dispatch_rule
+class static_dispatch_rule
 {
 private:
 
-    dispatch& m_dispatch;
-    const char* m_field_name;
+    static_dispatch& m_dispatch;
+    const char* m_field_name; // NULL means any
+    size_t m_length;
+    uint32_t m_hash;
 
 public:
 
-    explicit dispatch_rule(dispatch& parent_dispatch, const char* field_name) :
+    explicit static_dispatch_rule(static_dispatch& parent_dispatch, const char* field_name, size_t length, uint32_t hash) :
         m_dispatch(parent_dispatch),
-        m_field_name(field_name)
+        m_field_name(field_name),
+        m_length(length),
+        m_hash(hash)
     {
     }
 
     template<typename Handler>
-    dispatch& operator>>(Handler handler) const
+    static_dispatch& operator>>(Handler handler) const
     {
-        if (!m_dispatch.m_handled && ((m_field_name == NULL) || (strcmp(m_dispatch.m_field_name, m_field_name) == 0)))
+        if (!m_dispatch.m_handled && ((m_field_name == NULL) || m_dispatch.matches(m_field_name, m_length, m_hash)))
         {
             handler();
             m_dispatch.m_handled = true;
@@ -1218,67 +5926,230 @@ public:
 
         return m_dispatch;
     }
-}; // class dispatch_rule
+}; // class static_dispatch_rule
 
-template<typename Context>
-class ignore
+} // namespace detail
+
+inline detail::static_dispatch_rule static_dispatch::operator<<(const static_key& key)
 {
-    Context& m_context;
+    return detail::static_dispatch_rule(*this, key.name(), key.length(), key.hash());
+}
+
+template<typename Char>
+detail::static_dispatch_rule static_dispatch::operator<<(const Char* const& field_name)
+{
+    const size_t length = (field_name != NULL) ? std::strlen(field_name) : 0;
+    const uint32_t hash = (field_name != NULL) ? detail::runtime_key_hash(field_name, length) : 0;
+
+    return detail::static_dispatch_rule(*this, field_name, length, hash);
+}
+
+#endif // MJR_CPP11_SUPPORTED
+
+#ifdef MJR_MMAP_SUPPORTED
 
+// A read-only memory mapping of a whole file, e.g. to be parsed with parse_ndjson.
+// The constructor throws std::runtime_error if the file cannot be opened or mapped.
+class mapped_file MJR_FINAL : private detail::file_mapping
+{
 public:
 
-    explicit ignore(Context& context) :
-        m_context(context)
+    explicit mapped_file(const char* path) :
+        detail::file_mapping(path)
     {
     }
 
-    void operator()(const char*, value)
+    explicit mapped_file(const std::string& path) :
+        detail::file_mapping(path.c_str())
     {
-        operator()();
     }
 
-    void operator()(value)
+    const char* data() const
     {
-        operator()();
+        return detail::file_mapping::data();
     }
 
-    void operator()() const
+    size_t size() const
+    {
+        return detail::file_mapping::size();
+    }
+}; // class mapped_file
+
+#endif // MJR_MMAP_SUPPORTED
+
+#ifdef MJR_COROUTINES_SUPPORTED
+
+// The events of a message, read as they are iterated over: the parsing runs in a coroutine that
+// is suspended after each event, and that is destroyed, halting the parsing, with the generator.
+class event_generator
+{
+public:
+
+    class promise_type
     {
-        switch (m_context.nested_status())
+    private:
+
+        friend class event_generator;
+
+        const event* m_event = nullptr;
+        std::exception_ptr m_exception;
+
+    public:
+
+        event_generator get_return_object()
         {
-        case Context::NESTED_STATUS_NONE:
-            break;
-        case Context::NESTED_STATUS_OBJECT:
-            parse_object(m_context, *this);
-            break;
-        case Context::NESTED_STATUS_ARRAY:
-            parse_array(m_context, *this);
-            break;
+            return event_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(const event& e) noexcept
+        {
+            m_event = &e;
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            m_exception = std::current_exception();
+        }
+    }; // class promise_type
+
+    class iterator
+    {
+    private:
+
+        std::coroutine_handle<promise_type> m_coroutine;
+
+    public:
+
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = event;
+        using pointer = const event*;
+        using reference = const event&;
+
+        iterator() = default;
+
+        explicit iterator(std::coroutine_handle<promise_type> coroutine) :
+            m_coroutine(coroutine)
+        {
+        }
+
+        reference operator*() const
+        {
+            return *m_coroutine.promise().m_event;
+        }
+
+        pointer operator->() const
+        {
+            return m_coroutine.promise().m_event;
+        }
+
+        iterator& operator++()
+        {
+            resume(m_coroutine);
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t)
+        {
+            return it.m_coroutine.done();
         }
+    }; // class iterator
+
+private:
+
+    std::coroutine_handle<promise_type> m_coroutine;
+
+    explicit event_generator(std::coroutine_handle<promise_type> coroutine) :
+        m_coroutine(coroutine)
+    {
     }
-}; // class ignore
 
-} // namespace detail
+    static void resume(std::coroutine_handle<promise_type> coroutine)
+    {
+        coroutine.resume();
+        if (coroutine.done() && coroutine.promise().m_exception)
+        {
+            std::rethrow_exception(coroutine.promise().m_exception);
+        }
+    }
 
-inline detail::dispatch_rule dispatch::operator<<(const char* field_name)
-{
-    return detail::dispatch_rule(*this, field_name);
-}
+public:
 
-inline detail::dispatch_rule dispatch::operator<<(const std::string& field_name)
-{
-    return operator<<(field_name.c_str());
-}
+    event_generator(event_generator&& other) noexcept :
+        m_coroutine(std::exchange(other.m_coroutine, nullptr))
+    {
+    }
 
-static const char* const any = NULL;
+    event_generator& operator=(event_generator&& other) noexcept
+    {
+        std::swap(m_coroutine, other.m_coroutine);
+        return *this;
+    }
+
+    ~event_generator()
+    {
+        if (m_coroutine)
+        {
+            m_coroutine.destroy();
+        }
+    }
 
+    // can be called only once: the events are read as the returned iterator is incremented
+    iterator begin()
+    {
+        resume(m_coroutine);
+        return iterator(m_coroutine);
+    }
+
+    std::default_sentinel_t end() const noexcept
+    {
+        return {};
+    }
+}; // class event_generator
+
+// Parses the message read from the context lazily, one event per iteration. Names and scalar
+// values have the same lifetime as with parse_object, and the same errors are thrown, by the
+// iterator. Like parse_object, it can be called by a handler to read a nested object or array.
+// Only one coroutine frame is allocated, for the whole message.
 template<typename Context>
-void ignore(Context& context)
+event_generator parse_events(Context& context)
 {
-    detail::ignore<Context> ignore(context);
-    ignore();
+    detail::event_reader<Context> reader(context);
+
+    event e;
+    while (reader.next(e))
+    {
+        co_yield e;
+    }
+
+    if (context.status().failed())
+    {
+        detail::throw_error(context);
+    }
 }
 
+#endif // MJR_COROUTINES_SUPPORTED
+
 } // namespace minijson
 
 #endif // MINIJSON_READER_H
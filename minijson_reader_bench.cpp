@@ -0,0 +1,514 @@
+#include "minijson_reader.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <memory>
+#include <sstream>
+
+// Throughput of the contexts over synthetic documents shaped like the usual JSON corpora
+// (twitter.json, citm_catalog.json, canada.json, ...), which are generated at startup, so
+// that the results do not depend on files that are not part of the repository.
+
+namespace
+{
+
+struct corpus
+{
+    std::string name;
+    std::string text;
+    std::vector<std::pair<size_t, size_t> > documents; // offset and length of every message
+    std::vector<std::string> keys; // the fields extracted by the dispatch benchmarks
+};
+
+// deterministic, so that runs can be compared
+class generator
+{
+private:
+
+    uint32_t m_state;
+
+public:
+
+    generator() :
+        m_state(12345)
+    {
+    }
+
+    uint32_t next(uint32_t bound)
+    {
+        m_state = m_state * 1103515245 + 12345;
+        return (m_state >> 8) % bound;
+    }
+
+    std::string number()
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%u", next(1000000000));
+        return buffer;
+    }
+
+    std::string real()
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.13g", (static_cast<double>(next(36000000)) / 100000.0) - 180.0);
+        return buffer;
+    }
+
+    std::string word(size_t length)
+    {
+        std::string result;
+        for (size_t i = 0; i < length; i++)
+        {
+            result += static_cast<char>('a' + next(26));
+        }
+        return result;
+    }
+
+    std::string text(size_t words)
+    {
+        static const char* const extras[] = { " ", " ", " ", " ", "\\n", "\\\"", "\\u00e9", "\\ud83d\\ude00", "\\/" };
+        std::string result;
+        for (size_t i = 0; i < words; i++)
+        {
+            result += word(1 + next(9));
+            result += extras[next(sizeof(extras) / sizeof(extras[0]))];
+        }
+        return result;
+    }
+};
+
+const size_t CORPUS_SIZE = 1 << 20;
+
+corpus single_document(const std::string& name, const std::string& text, const char* const* keys, size_t key_count)
+{
+    corpus result;
+    result.name = name;
+    result.text = text;
+    result.documents.push_back(std::make_pair(0, text.size()));
+    result.keys.assign(keys, keys + key_count);
+    return result;
+}
+
+corpus twitter_like()
+{
+    generator g;
+    std::string text = "{\"statuses\":[";
+    for (size_t i = 0; text.size() < CORPUS_SIZE; i++)
+    {
+        text += (i > 0) ? "," : "";
+        text += "{\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":" + g.number() + ",\"id_str\":\"" + g.number() + "\","
+            "\"text\":\"" + g.text(12) + "\",\"truncated\":false,\"in_reply_to_status_id\":null,"
+            "\"entities\":{\"hashtags\":[{\"text\":\"" + g.word(8) + "\",\"indices\":[" + g.number() + "," + g.number() + "]}],\"urls\":[]},"
+            "\"user\":{\"id\":" + g.number() + ",\"name\":\"" + g.text(2) + "\",\"screen_name\":\"" + g.word(10) + "\","
+            "\"description\":\"" + g.text(15) + "\",\"followers_count\":" + g.number() + ",\"verified\":" + (g.next(2) ? "true" : "false") + "},"
+            "\"retweet_count\":" + g.number() + ",\"favorited\":false,\"lang\":\"ja\"}";
+    }
+    text += "]}";
+
+    const char* const keys[] = { "statuses", "id", "text", "user", "screen_name" };
+    return single_document("twitter", text, keys, sizeof(keys) / sizeof(keys[0]));
+}
+
+corpus citm_like()
+{
+    generator g;
+    std::string text = "{\"events\":{";
+    for (size_t i = 0; text.size() < CORPUS_SIZE; i++)
+    {
+        const std::string id = g.number();
+        text += (i > 0) ? "," : "";
+        text += "\"" + id + "\":{\"description\":null,\"id\":" + id + ",\"logo\":\"/images/UE0AAAAACEKo" + g.word(4) + ".jpg\","
+            "\"name\":\"" + g.text(3) + "\",\"subTopicIds\":[" + g.number() + "," + g.number() + "," + g.number() + "],"
+            "\"subjectCode\":null,\"subtitle\":null,\"topicIds\":[" + g.number() + "," + g.number() + "]}";
+    }
+    text += "},\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}";
+
+    const char* const keys[] = { "events", "id", "name" };
+    return single_document("citm", text, keys, sizeof(keys) / sizeof(keys[0]));
+}
+
+corpus canada_like()
+{
+    generator g;
+    std::string text = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+        "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+    for (size_t i = 0; text.size() < CORPUS_SIZE; i++)
+    {
+        text += (i > 0) ? ",[" : "[";
+        for (size_t j = 0; j < 100; j++)
+        {
+            text += (j > 0) ? ",[" : "[";
+            text += g.real() + "," + g.real() + "]";
+        }
+        text += "]";
+    }
+    text += "]}}]}";
+
+    const char* const keys[] = { "features", "type", "properties", "name" };
+    return single_document("canada", text, keys, sizeof(keys) / sizeof(keys[0]));
+}
+
+corpus deeply_nested()
+{
+    generator g;
+    std::string text = "[";
+    for (size_t i = 0; text.size() < CORPUS_SIZE; i++)
+    {
+        text += (i > 0) ? "," : "";
+        const size_t depth = 1 + g.next(MJR_NESTING_LIMIT - 1);
+        for (size_t j = 0; j < depth; j++)
+        {
+            text += (j % 2 == 0) ? "{\"a\":" : "[" + g.number() + ",";
+        }
+        text += "\"" + g.word(4) + "\"";
+        for (size_t j = depth; j > 0; j--)
+        {
+            text += ((j - 1) % 2 == 0) ? "}" : "]";
+        }
+    }
+    text += "]";
+
+    const char* const keys[] = { "a" };
+    return single_document("deeply_nested", text, keys, sizeof(keys) / sizeof(keys[0]));
+}
+
+corpus string_heavy()
+{
+    generator g;
+    std::string text = "[";
+    for (size_t i = 0; text.size() < CORPUS_SIZE; i++)
+    {
+        text += (i > 0) ? "," : "";
+        text += "{\"s\":\"" + g.text(200) + "\",\"t\":\"" + g.word(500) + "\"}";
+    }
+    text += "]";
+
+    const char* const keys[] = { "s" };
+    return single_document("string_heavy", text, keys, sizeof(keys) / sizeof(keys[0]));
+}
+
+corpus ndjson()
+{
+    generator g;
+    corpus result;
+    result.name = "ndjson";
+    while (result.text.size() < CORPUS_SIZE)
+    {
+        const size_t offset = result.text.size();
+        result.text += "{\"id\":" + g.number() + ",\"kind\":\"" + g.word(6) + "\",\"score\":" + g.real() + ","
+            "\"tags\":[\"" + g.word(3) + "\",\"" + g.word(5) + "\"],\"payload\":{\"ok\":true,\"msg\":\"" + g.text(6) + "\"}}";
+        result.documents.push_back(std::make_pair(offset, result.text.size() - offset));
+        result.text += "\n";
+    }
+
+    const char* const keys[] = { "id", "score" };
+    result.keys.assign(keys, keys + sizeof(keys) / sizeof(keys[0]));
+    return result;
+}
+
+// visits every value, decoding numbers
+template<typename Context>
+struct traverse_handler
+{
+    Context& context;
+    size_t& count;
+
+    explicit traverse_handler(Context& context, size_t& count) :
+        context(context),
+        count(count)
+    {
+    }
+
+    void operator()(const char*, minijson::value value)
+    {
+        (*this)(value);
+    }
+
+    void operator()(minijson::value value)
+    {
+        switch (value.type())
+        {
+        case minijson::Object:
+            minijson::parse_object(context, *this);
+            break;
+        case minijson::Array:
+            minijson::parse_array(context, *this);
+            break;
+        case minijson::Number:
+            benchmark::DoNotOptimize(value.as_double());
+            break;
+        default:
+            break;
+        }
+        count++;
+    }
+};
+
+// skips every nested object or array of the message
+template<typename Context>
+struct ignore_handler
+{
+    Context& context;
+    size_t& count;
+
+    explicit ignore_handler(Context& context, size_t& count) :
+        context(context),
+        count(count)
+    {
+    }
+
+    void operator()(const char*, minijson::value value)
+    {
+        (*this)(value);
+    }
+
+    void operator()(minijson::value value)
+    {
+        if ((value.type() == minijson::Object) || (value.type() == minijson::Array))
+        {
+            minijson::ignore(context);
+        }
+        count++;
+    }
+};
+
+// walks arrays, and only the fields of objects that are in the table, ignoring the others
+template<typename Context>
+struct dispatch_handler
+{
+    Context& context;
+    size_t& count;
+    const minijson::dispatch_table& table;
+
+    explicit dispatch_handler(Context& context, size_t& count, const minijson::dispatch_table& table) :
+        context(context),
+        count(count),
+        table(table)
+    {
+    }
+
+    void operator()(const minijson::key& name, minijson::value value)
+    {
+        if (table.find(name) != minijson::dispatch_table::NOT_FOUND)
+        {
+            (*this)(value);
+        }
+        else if ((value.type() == minijson::Object) || (value.type() == minijson::Array))
+        {
+            minijson::ignore(context);
+        }
+    }
+
+    void operator()(minijson::value value)
+    {
+        switch (value.type())
+        {
+        case minijson::Object:
+            minijson::parse_object(context, *this);
+            break;
+        case minijson::Array:
+            minijson::parse_array(context, *this);
+            break;
+        default:
+            count += std::strlen(value.as_string());
+            break;
+        }
+    }
+};
+
+enum workload
+{
+    TRAVERSE,
+    IGNORE,
+    DISPATCH
+};
+
+template<typename Context>
+void parse_message(Context& context, char first_char, workload w, size_t& count, const minijson::dispatch_table& table)
+{
+    switch (w)
+    {
+    case TRAVERSE:
+        if (first_char == '{')
+        {
+            minijson::parse_object(context, traverse_handler<Context>(context, count));
+        }
+        else
+        {
+            minijson::parse_array(context, traverse_handler<Context>(context, count));
+        }
+        break;
+    case IGNORE:
+        if (first_char == '{')
+        {
+            minijson::parse_object(context, ignore_handler<Context>(context, count));
+        }
+        else
+        {
+            minijson::parse_array(context, ignore_handler<Context>(context, count));
+        }
+        break;
+    case DISPATCH:
+        if (first_char == '{')
+        {
+            minijson::parse_object(context, dispatch_handler<Context>(context, count, table));
+        }
+        else
+        {
+            minijson::parse_array(context, dispatch_handler<Context>(context, count, table));
+        }
+        break;
+    }
+}
+
+void report(benchmark::State& state, const corpus& c, size_t count)
+{
+    benchmark::DoNotOptimize(count);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * c.text.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * c.documents.size())); // documents per second
+}
+
+void bench_buffer_context(benchmark::State& state, const corpus* c, workload w)
+{
+    const minijson::dispatch_table table(c->keys);
+    std::vector<char> buffer(c->text.size());
+    size_t count = 0;
+    for (auto _ : state)
+    {
+        // buffer_context decodes strings in place, so the input is restored before each run
+        state.PauseTiming();
+        std::copy(c->text.begin(), c->text.end(), buffer.begin());
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < c->documents.size(); i++)
+        {
+            minijson::buffer_context context(&buffer[c->documents[i].first], c->documents[i].second);
+            parse_message(context, buffer[c->documents[i].first], w, count, table);
+        }
+    }
+    report(state, *c, count);
+}
+
+void bench_const_buffer_context(benchmark::State& state, const corpus* c, workload w)
+{
+    const minijson::dispatch_table table(c->keys);
+    size_t count = 0;
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < c->documents.size(); i++)
+        {
+            minijson::const_buffer_context context(&c->text[c->documents[i].first], c->documents[i].second);
+            parse_message(context, c->text[c->documents[i].first], w, count, table);
+        }
+    }
+    report(state, *c, count);
+}
+
+void bench_istream_context(benchmark::State& state, const corpus* c, workload w)
+{
+    const minijson::dispatch_table table(c->keys);
+    std::istringstream stream;
+    size_t count = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        stream.clear();
+        stream.str(c->text);
+        state.ResumeTiming();
+
+        // the messages are read one after the other from the same stream
+        for (size_t i = 0; i < c->documents.size(); i++)
+        {
+            minijson::istream_context context(stream);
+            parse_message(context, c->text[c->documents[i].first], w, count, table);
+        }
+    }
+    report(state, *c, count);
+}
+
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+
+// the index of every message is built in the timed loop, as it would be for a message seen once
+void bench_indexed_const_buffer_context(benchmark::State& state, const corpus* c, workload w)
+{
+    const minijson::dispatch_table table(c->keys);
+    minijson::structural_index index;
+    size_t count = 0;
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < c->documents.size(); i++)
+        {
+            index.build(&c->text[c->documents[i].first], c->documents[i].second);
+            minijson::const_buffer_context context(&c->text[c->documents[i].first], c->documents[i].second);
+            context.set_index(index);
+            parse_message(context, c->text[c->documents[i].first], w, count, table);
+        }
+    }
+    report(state, *c, count);
+}
+
+// the indexes are built once, and reused by every run, as they would be for a buffer parsed
+// several times
+void bench_prebuilt_index_const_buffer_context(benchmark::State& state, const corpus* c, workload w)
+{
+    const minijson::dispatch_table table(c->keys);
+    std::vector<std::unique_ptr<minijson::structural_index> > indexes;
+    for (size_t i = 0; i < c->documents.size(); i++)
+    {
+        indexes.emplace_back(new minijson::structural_index(&c->text[c->documents[i].first], c->documents[i].second));
+    }
+
+    size_t count = 0;
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < c->documents.size(); i++)
+        {
+            minijson::const_buffer_context context(&c->text[c->documents[i].first], c->documents[i].second);
+            context.set_index(*indexes[i]);
+            parse_message(context, c->text[c->documents[i].first], w, count, table);
+        }
+    }
+    report(state, *c, count);
+}
+
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    static std::vector<corpus> corpora;
+    corpora.push_back(twitter_like());
+    corpora.push_back(citm_like());
+    corpora.push_back(canada_like());
+    corpora.push_back(deeply_nested());
+    corpora.push_back(string_heavy());
+    corpora.push_back(ndjson());
+
+    const char* const workload_names[] = { "traverse", "ignore", "dispatch" };
+    for (size_t w = 0; w < sizeof(workload_names) / sizeof(workload_names[0]); w++)
+    {
+        for (size_t i = 0; i < corpora.size(); i++)
+        {
+            const std::string suffix = std::string("/") + workload_names[w] + "/" + corpora[i].name;
+            benchmark::RegisterBenchmark(("buffer_context" + suffix).c_str(), bench_buffer_context, &corpora[i], static_cast<workload>(w));
+            benchmark::RegisterBenchmark(("const_buffer_context" + suffix).c_str(), bench_const_buffer_context, &corpora[i], static_cast<workload>(w));
+            benchmark::RegisterBenchmark(("istream_context" + suffix).c_str(), bench_istream_context, &corpora[i], static_cast<workload>(w));
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+            benchmark::RegisterBenchmark(("indexed_const_buffer_context" + suffix).c_str(), bench_indexed_const_buffer_context, &corpora[i], static_cast<workload>(w));
+            benchmark::RegisterBenchmark(("prebuilt_index_const_buffer_context" + suffix).c_str(), bench_prebuilt_index_const_buffer_context, &corpora[i], static_cast<workload>(w));
+#endif
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
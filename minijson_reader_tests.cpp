@@ -1,9 +1,18 @@
 #include "minijson_reader.hpp"
 
+#if MJR_CPP11_SUPPORTED
+#include "minijson_ndjson.hpp"
+#endif
+
 #include <gtest/gtest.h>
 
 #include <bitset>
 
+#if MJR_CPP11_SUPPORTED && defined(MJR_MMAP_SUPPORTED)
+#include "nested_json/batch.hpp"
+#include "nested_json/offset_index.hpp"
+#endif
+
 template<typename T, size_t Size>
 bool arrays_match(const T (&expected)[Size], const T (&actual)[Size])
 {
@@ -90,6 +99,41 @@ TEST(minijson_reader, istream_context)
     test_context_helper(istream_context);
 }
 
+TEST(minijson_reader_detail, string_arena)
+{
+    minijson::detail::string_arena arena;
+    ASSERT_EQ(NULL, arena.string());
+    ASSERT_EQ(0U, arena.chunk_count());
+
+    std::vector<const char*> strings;
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 2000; i++)
+    {
+        // mix short strings with ones long enough to outgrow their chunk
+        const std::string str = (i % 500 == 499) ? std::string(3 * minijson::detail::string_arena::MAX_CHUNK_SIZE, 'L') : std::string(i % 50, 'a' + i % 26);
+        arena.new_string();
+        arena.append(str.data(), str.size() / 2);
+        for (size_t j = str.size() / 2; j < str.size(); j++)
+        {
+            arena.append(str[j]);
+        }
+        arena.append(0);
+
+        strings.push_back(arena.string());
+        expected.push_back(str);
+    }
+
+    // all the strings are still valid
+    for (size_t i = 0; i < strings.size(); i++)
+    {
+        ASSERT_EQ(expected[i], strings[i]);
+    }
+    ASSERT_LT(arena.chunk_count(), 20U);
+
+    arena.new_string();
+    ASSERT_EQ(NULL, arena.string());
+}
+
 template<typename Context>
 void test_context_copy_construction_helper(const Context& original)
 {
@@ -337,6 +381,88 @@ TEST(minijson_reader_detail, parse_long_invalid_restore_errno)
     ASSERT_EQ(42, errno);
 }
 
+bool parse_int64_helper(const std::string& str, int64_t& result)
+{
+    return minijson::detail::parse_int64(str.data(), str.data() + str.size(), result);
+}
+
+bool parse_uint64_helper(const std::string& str, uint64_t& result)
+{
+    return minijson::detail::parse_uint64(str.data(), str.data() + str.size(), result);
+}
+
+TEST(minijson_reader_detail, parse_int64)
+{
+    int64_t result = 0;
+
+    ASSERT_TRUE(parse_int64_helper("0", result));                    ASSERT_EQ(0, result);
+    ASSERT_TRUE(parse_int64_helper("-0", result));                   ASSERT_EQ(0, result);
+    ASSERT_TRUE(parse_int64_helper("42", result));                   ASSERT_EQ(42, result);
+    ASSERT_TRUE(parse_int64_helper("-42", result));                  ASSERT_EQ(-42, result);
+    ASSERT_TRUE(parse_int64_helper("+42", result));                  ASSERT_EQ(42, result);
+    ASSERT_TRUE(parse_int64_helper("12345678", result));             ASSERT_EQ(12345678, result);
+    ASSERT_TRUE(parse_int64_helper("1234567890123456", result));     ASSERT_EQ(1234567890123456LL, result);
+    ASSERT_TRUE(parse_int64_helper("9223372036854775807", result));  ASSERT_EQ(std::numeric_limits<int64_t>::max(), result);
+    ASSERT_TRUE(parse_int64_helper("-9223372036854775808", result)); ASSERT_EQ(std::numeric_limits<int64_t>::min(), result);
+    ASSERT_TRUE(parse_int64_helper("00000000000000000000000000042", result)); ASSERT_EQ(42, result);
+
+    ASSERT_FALSE(parse_int64_helper("9223372036854775808", result));
+    ASSERT_FALSE(parse_int64_helper("-9223372036854775809", result));
+    ASSERT_FALSE(parse_int64_helper("18446744073709551616", result));
+    ASSERT_FALSE(parse_int64_helper("123456789012345678901234567890", result));
+    ASSERT_FALSE(parse_int64_helper("", result));
+    ASSERT_FALSE(parse_int64_helper("-", result));
+    ASSERT_FALSE(parse_int64_helper("--1", result));
+    ASSERT_FALSE(parse_int64_helper("1.0", result));
+    ASSERT_FALSE(parse_int64_helper("0x10", result));
+
+    // a non-digit anywhere, including in the middle of an 8-digit block
+    for (size_t length = 1; length < 24; length++)
+    {
+        for (size_t pos = 0; pos < length; pos++)
+        {
+            std::string str(length, '1');
+            str[pos] = (pos % 2 == 0) ? '/' : ':'; // the characters right before and after the digits
+            ASSERT_FALSE(parse_int64_helper(str, result)) << str;
+        }
+    }
+
+    // every length and digit position, checked against a digit-by-digit computation
+    for (size_t length = 1; length <= 18; length++)
+    {
+        std::string str;
+        int64_t expected = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            str += static_cast<char>('0' + (i * 7 + length) % 10);
+            expected = expected * 10 + (i * 7 + length) % 10;
+        }
+
+        ASSERT_TRUE(parse_int64_helper(str, result)) << str;
+        ASSERT_EQ(expected, result) << str;
+        ASSERT_TRUE(parse_int64_helper("-" + str, result)) << str;
+        ASSERT_EQ(-expected, result) << str;
+    }
+}
+
+TEST(minijson_reader_detail, parse_uint64)
+{
+    uint64_t result = 0;
+
+    ASSERT_TRUE(parse_uint64_helper("0", result));                     ASSERT_EQ(0U, result);
+    ASSERT_TRUE(parse_uint64_helper("-0", result));                    ASSERT_EQ(0U, result);
+    ASSERT_TRUE(parse_uint64_helper("9223372036854775808", result));   ASSERT_EQ(9223372036854775808ULL, result);
+    ASSERT_TRUE(parse_uint64_helper("18446744073709551615", result));  ASSERT_EQ(std::numeric_limits<uint64_t>::max(), result);
+    ASSERT_TRUE(parse_uint64_helper("018446744073709551615", result)); ASSERT_EQ(std::numeric_limits<uint64_t>::max(), result);
+
+    ASSERT_FALSE(parse_uint64_helper("18446744073709551616", result));
+    ASSERT_FALSE(parse_uint64_helper("18446744073709551620", result));
+    ASSERT_FALSE(parse_uint64_helper("99999999999999999999", result));
+    ASSERT_FALSE(parse_uint64_helper("184467440737095516150", result));
+    ASSERT_FALSE(parse_uint64_helper("-1", result));
+    ASSERT_FALSE(parse_uint64_helper("1e3", result));
+}
+
 TEST(minijson_reader_detail, parse_double)
 {
     ASSERT_DOUBLE_EQ(0, minijson::detail::parse_double("0"));
@@ -365,6 +491,55 @@ TEST(minijson_reader_detail, parse_double)
 #endif
 }
 
+static uint64_t double_bits(double value)
+{
+    uint64_t result;
+    std::memcpy(&result, &value, sizeof(result));
+
+    return result;
+}
+
+TEST(minijson_reader_detail, parse_double_correctly_rounded)
+{
+    // results are compared bit by bit: the parser must be exact, not just close
+    ASSERT_EQ(double_bits(0.1), double_bits(minijson::detail::parse_double("0.1")));
+    ASSERT_EQ(double_bits(-0.0), double_bits(minijson::detail::parse_double("-0")));
+    ASSERT_EQ(double_bits(-0.0), double_bits(minijson::detail::parse_double("-0.0e999")));
+    ASSERT_EQ(double_bits(1e23), double_bits(minijson::detail::parse_double("1e23")));
+    ASSERT_EQ(double_bits(0.5), double_bits(minijson::detail::parse_double(".5")));
+    ASSERT_EQ(double_bits(5.0), double_bits(minijson::detail::parse_double("5.")));
+    ASSERT_EQ(double_bits(123.456), double_bits(minijson::detail::parse_double("000123.4560000")));
+    ASSERT_EQ(double_bits(-45.8897), double_bits(minijson::detail::parse_double("-45.889700000000000000000001")));
+    ASSERT_EQ(double_bits(1.7976931348623157e308), double_bits(minijson::detail::parse_double("1.7976931348623157e308")));
+    ASSERT_EQ(double_bits(2.2250738585072014e-308), double_bits(minijson::detail::parse_double("2.2250738585072014e-308")));
+    ASSERT_EQ(double_bits(2.2250738585072011e-308), double_bits(minijson::detail::parse_double("2.2250738585072011e-308")));
+    ASSERT_EQ(double_bits(4.9406564584124654e-324), double_bits(minijson::detail::parse_double("4.9406564584124654e-324")));
+
+    // 2^53 + 1 is halfway between two doubles and rounds to even, one more digit breaks the tie
+    ASSERT_EQ(double_bits(9007199254740992.0), double_bits(minijson::detail::parse_double("9007199254740993")));
+    ASSERT_EQ(double_bits(9007199254740994.0), double_bits(minijson::detail::parse_double("9007199254740993.0000000000001")));
+
+    // 1 + 2^-53 (halfway between 1 and the next double) needs every digit to be rounded correctly
+    ASSERT_EQ(double_bits(1.0), double_bits(minijson::detail::parse_double("1.00000000000000011102230246251565404236316680908203125")));
+    ASSERT_EQ(double_bits(1.0000000000000002), double_bits(minijson::detail::parse_double("1.00000000000000011102230246251565404236316680908203126")));
+
+    char buf[64];
+    uint64_t bits = 0x3FF0000000000000ULL;
+    for (size_t i = 0; i < 10000; i++)
+    {
+        bits = bits * 6364136223846793005ULL + 1442695040888963407ULL; // LCG
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (value != value || value - value != 0) // NaN or infinity
+        {
+            continue;
+        }
+
+        sprintf(buf, "%.17g", value);
+        ASSERT_EQ(bits, double_bits(minijson::detail::parse_double(buf))) << buf;
+    }
+}
+
 TEST(minijson_reader_detail, parse_double_invalid)
 {
     ASSERT_THROW(minijson::detail::parse_double(""), minijson::detail::number_parse_error);
@@ -380,6 +555,15 @@ TEST(minijson_reader_detail, parse_double_invalid)
     ASSERT_THROW(minijson::detail::parse_double("42.42E+094 "), minijson::detail::number_parse_error);
     ASSERT_THROW(minijson::detail::parse_double("42.42E+09.4"), minijson::detail::number_parse_error);
 
+    ASSERT_THROW(minijson::detail::parse_double("."), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("-.e1"), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("4e"), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("4e+"), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("4.2.1"), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("12345678.12345678x"), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("inf"), minijson::detail::number_parse_error);
+    ASSERT_THROW(minijson::detail::parse_double("nan"), minijson::detail::number_parse_error);
+
     ASSERT_THROW(minijson::detail::parse_double("1.0E+999"), minijson::detail::number_parse_error); // overflow
     ASSERT_THROW(minijson::detail::parse_double("-1.0E+999"), minijson::detail::number_parse_error); // overflow
     ASSERT_THROW(minijson::detail::parse_double("1.0E-999"), minijson::detail::number_parse_error); // underflow
@@ -393,6 +577,29 @@ TEST(minijson_reader_detail, parse_double_invalid_restore_errno)
     ASSERT_EQ(42, errno);
 }
 
+TEST(minijson_reader_detail, is_valid_number)
+{
+    const char* const valid[] =
+    {
+        "0", "-0", "+1", "42", "42.42", ".5", "5.", "1e5", "1E+5", "1e-5", "0.000e99999",
+        "1.7976931348623157e308", "17976931348623157e292", "0.00001e-300", "4.9406564584124654e-324",
+    };
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+    {
+        ASSERT_TRUE(minijson::detail::is_valid_number(valid[i], valid[i] + strlen(valid[i]))) << valid[i];
+    }
+
+    const char* const invalid[] =
+    {
+        "", "-", ".", "1..2", "1e", "1e+", "0x10", "1f", " 1", "1 ", "inf",
+        "1.8e308", "-1.8e308", "1e-400", "0.0001e-320", "1000000e303",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        ASSERT_FALSE(minijson::detail::is_valid_number(invalid[i], invalid[i] + strlen(invalid[i]))) << invalid[i];
+    }
+}
+
 TEST(minijson_reader_detail, parse_utf16_escape_sequence)
 {
     ASSERT_EQ(0x0000u, minijson::detail::parse_utf16_escape_sequence("0000"));
@@ -538,6 +745,108 @@ TEST(minijson_reader_detail, read_quoted_string_invalid)
 }
 
 
+TEST(minijson_reader_detail, find_string_special)
+{
+    const char specials[] = { '"', '\\', '\0', '\n', '\x1F' };
+
+    for (size_t length = 0; length < 80; length++)
+    {
+        // bytes >= 0x80 must not be mistaken for control characters
+        std::string buffer(length, 'a');
+        for (size_t i = 0; i < length; i += 3)
+        {
+            buffer[i] = '\xE4';
+        }
+
+        ASSERT_EQ(buffer.data() + length, minijson::detail::find_string_special(buffer.data(), buffer.data() + length));
+
+        for (size_t pos = 0; pos < length; pos++)
+        {
+            for (size_t i = 0; i < sizeof(specials); i++)
+            {
+                std::string special_buffer = buffer;
+                special_buffer[pos] = specials[i];
+                special_buffer[length - 1] = '"'; // a later special character must not matter
+                const char* const begin = special_buffer.data();
+                ASSERT_EQ(begin + pos, minijson::detail::find_string_special(begin, begin + length));
+            }
+        }
+    }
+}
+
+TEST(minijson_reader_detail, find_non_whitespace)
+{
+    const char whitespace[] = { ' ', '\n', '\t', '\r' };
+
+    for (size_t length = 0; length < 80; length++)
+    {
+        std::string buffer(length, ' ');
+        for (size_t i = 0; i < length; i++)
+        {
+            buffer[i] = whitespace[i % sizeof(whitespace)];
+        }
+
+        ASSERT_EQ(buffer.data() + length, minijson::detail::find_non_whitespace(buffer.data(), buffer.data() + length));
+
+        for (size_t pos = 0; pos < length; pos++)
+        {
+            std::string non_whitespace_buffer = buffer;
+            non_whitespace_buffer[pos] = (pos % 2 == 0) ? '\v' : '\0';
+            non_whitespace_buffer[length - 1] = '"'; // a later non-whitespace byte must not matter
+            const char* const begin = non_whitespace_buffer.data();
+            ASSERT_EQ(begin + pos, minijson::detail::find_non_whitespace(begin, begin + length));
+        }
+    }
+}
+
+template<typename Context>
+void read_quoted_string_long_helper(Context& context, const std::string& expected)
+{
+    minijson::detail::read_quoted_string(context);
+    ASSERT_EQ(expected, context.write_buffer());
+}
+
+TEST(minijson_reader_detail, read_quoted_string_long)
+{
+    std::string input = "\"";
+    std::string expected;
+    for (size_t i = 0; i < 100; i++)
+    {
+        const std::string run(i, static_cast<char>('a' + i % 26));
+        input += run + "\\n" + run + "\\u4F60" + "\xC3\xA0";
+        expected += run + "\n" + run + "\xE4\xBD\xA0" + "\xC3\xA0";
+    }
+    input += "\"";
+
+    std::vector<char> buffer(input.begin(), input.end());
+    minijson::buffer_context buffer_context(&buffer[0], buffer.size());
+    read_quoted_string_long_helper(buffer_context, expected);
+
+    minijson::const_buffer_context const_buffer_context(input.data(), input.size());
+    read_quoted_string_long_helper(const_buffer_context, expected);
+
+    std::istringstream stream(input);
+    minijson::istream_context istream_context(stream);
+    read_quoted_string_long_helper(istream_context, expected);
+}
+
+TEST(minijson_reader_detail, read_quoted_string_long_unterminated)
+{
+    const std::string input = "\"" + std::string(100, 'a');
+    minijson::const_buffer_context context(input.data(), input.size());
+
+    try
+    {
+        minijson::detail::read_quoted_string(context);
+        FAIL();
+    }
+    catch (const minijson::parse_error& parse_error)
+    {
+        ASSERT_EQ(minijson::parse_error::EXPECTED_CLOSING_QUOTE, parse_error.reason());
+        ASSERT_EQ(100U, parse_error.offset());
+    }
+}
+
 template<size_t Length>
 void read_unquoted_value_invalid_helper(
     const char (&buffer)[Length], minijson::parse_error::error_reason expected_reason, size_t expected_offset, const char* expected_what)
@@ -626,11 +935,53 @@ TEST(minijson_reader, value_example)
     const minijson::value value(minijson::Number, "42.42", 42, 42.42);
     ASSERT_EQ(minijson::Number, value.type());
     ASSERT_STREQ("42.42", value.as_string());
+    ASSERT_FALSE(value.is_integer());
     ASSERT_EQ(42, value.as_long());
     ASSERT_TRUE(value.as_bool());
     ASSERT_DOUBLE_EQ(42.42, value.as_double());
 }
 
+TEST(minijson_reader, value_size)
+{
+    // a pointer, a long or a double, the type and three flags
+    ASSERT_LE(sizeof(minijson::value), sizeof(const char*) + 2 * sizeof(double));
+
+    // only one of the numeric representations is kept
+    const minijson::value truncated(minijson::Number, "-3.75", -3, -3.75);
+    ASSERT_EQ(-3, truncated.as_long());
+    ASSERT_DOUBLE_EQ(-3.75, truncated.as_double());
+
+    const minijson::value converted(minijson::Number, "7", 7, 7.0);
+    ASSERT_TRUE(converted.is_integer());
+    ASSERT_EQ(7U, converted.as_uint64());
+    ASSERT_DOUBLE_EQ(7.0, converted.as_double());
+
+    const minijson::value huge(minijson::Number, "1e300", 0, 1e300);
+    ASSERT_EQ(0, huge.as_long());
+    ASSERT_DOUBLE_EQ(1e300, huge.as_double());
+}
+
+TEST(minijson_reader, value_lazy_number)
+{
+    // the representations are computed from the buffer only when asked for
+    char buffer[] = "12345";
+    const minijson::value value(buffer, true, minijson::detail::lazy_number_tag());
+    ASSERT_EQ(minijson::Number, value.type());
+    ASSERT_EQ(12345, value.as_long());
+
+    buffer[0] = '-';
+    ASSERT_EQ(-2345, value.as_long());
+    ASSERT_EQ(-2345, value.as_int64());
+    ASSERT_EQ(0U, value.as_uint64());
+    ASSERT_TRUE(value.as_bool());
+    ASSERT_DOUBLE_EQ(-2345.0, value.as_double());
+
+    buffer[2] = '.'; // no longer an integer, but value still believes it is
+    ASSERT_EQ(0, value.as_long());
+    ASSERT_FALSE(value.as_bool());
+    ASSERT_DOUBLE_EQ(-2.45, value.as_double());
+}
+
 template<typename Context>
 void parse_unquoted_value_invalid_helper(Context& context, size_t expected_offset)
 {
@@ -711,6 +1062,7 @@ TEST(minijson_reader_detail, parse_unquoted_value_integer)
     const minijson::value value = minijson::detail::parse_unquoted_value(buffer_context);
     ASSERT_EQ(minijson::Number, value.type());
     ASSERT_STREQ("42",          value.as_string());
+    ASSERT_TRUE(                value.is_integer());
     ASSERT_EQ(42,               value.as_long());
     ASSERT_TRUE(                value.as_bool());
     ASSERT_DOUBLE_EQ(42.0,      value.as_double());
@@ -725,11 +1077,67 @@ TEST(minijson_reader_detail, parse_unquoted_value_double)
     const minijson::value value = minijson::detail::parse_unquoted_value(buffer_context);
     ASSERT_EQ(minijson::Number, value.type());
     ASSERT_STREQ("42.0e+76",    value.as_string());
+    ASSERT_FALSE(               value.is_integer());
     ASSERT_EQ(0,                value.as_long());
     ASSERT_FALSE(               value.as_bool());
     ASSERT_DOUBLE_EQ(42.0E+76,  value.as_double());
 }
 
+template<size_t Length>
+minijson::value parse_unquoted_value_helper(char (&buffer)[Length]) // numbers are parsed from buffer on demand
+{
+    minijson::buffer_context context(buffer, Length - 1);
+    minijson::detail::read_unquoted_value(context);
+
+    const minijson::value value = minijson::detail::parse_unquoted_value(context);
+    EXPECT_EQ(minijson::Number, value.type());
+    EXPECT_STREQ(std::string(buffer, Length - 2).c_str(), value.as_string());
+
+    return value;
+}
+
+TEST(minijson_reader_detail, parse_unquoted_value_int64_uint64)
+{
+    {
+        char buffer[] = "-42,";
+        const minijson::value value = parse_unquoted_value_helper(buffer);
+        ASSERT_EQ(-42, value.as_long());
+        ASSERT_EQ(-42, value.as_int64());
+        ASSERT_EQ(0U, value.as_uint64());
+        ASSERT_DOUBLE_EQ(-42.0, value.as_double());
+    }
+    {
+        char buffer[] = "-9223372036854775808,";
+        const minijson::value value = parse_unquoted_value_helper(buffer);
+        ASSERT_EQ(std::numeric_limits<int64_t>::min(), value.as_int64());
+        ASSERT_EQ(0U, value.as_uint64());
+        ASSERT_DOUBLE_EQ(-9223372036854775808.0, value.as_double());
+    }
+    {
+        char buffer[] = "18446744073709551615]";
+        const minijson::value value = parse_unquoted_value_helper(buffer);
+        ASSERT_EQ(0, value.as_long());
+        ASSERT_EQ(0, value.as_int64());
+        ASSERT_EQ(std::numeric_limits<uint64_t>::max(), value.as_uint64());
+        ASSERT_DOUBLE_EQ(18446744073709551615.0, value.as_double());
+    }
+    {
+        char buffer[] = "123456789012345678901234567890}";
+        const minijson::value value = parse_unquoted_value_helper(buffer);
+        ASSERT_EQ(0, value.as_long());
+        ASSERT_EQ(0, value.as_int64());
+        ASSERT_EQ(0U, value.as_uint64());
+        ASSERT_DOUBLE_EQ(123456789012345678901234567890.0, value.as_double());
+    }
+    {
+        char buffer[] = "4.5e1,";
+        const minijson::value value = parse_unquoted_value_helper(buffer);
+        ASSERT_EQ(0, value.as_int64());
+        ASSERT_EQ(0U, value.as_uint64());
+        ASSERT_DOUBLE_EQ(45.0, value.as_double());
+    }
+}
+
 TEST(minijson_reader_detail, parse_unquoted_value_invalid)
 {
     char buffer[] = "asd,";
@@ -739,6 +1147,46 @@ TEST(minijson_reader_detail, parse_unquoted_value_invalid)
     parse_unquoted_value_invalid_helper(buffer_context, 3);
 }
 
+TEST(minijson_reader_detail, parse_unquoted_value_literal_prefix)
+{
+    const char* const inputs[] = { "tru,", "truee,", "fals,", "nul,", "nulll,", "True,", "-,", "e5," };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        minijson::const_buffer_context buffer_context(inputs[i], strlen(inputs[i]));
+        minijson::detail::read_unquoted_value(buffer_context);
+
+        parse_unquoted_value_invalid_helper(buffer_context, strlen(inputs[i]) - 1);
+    }
+}
+
+TEST(minijson_reader_detail, parse_unquoted_value_is_integer)
+{
+    const char* const integers[] = { "0,", "-0,", "42,", "-9223372036854775808,", "123456789012345678901234567890," };
+    for (size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); i++)
+    {
+        minijson::const_buffer_context buffer_context(integers[i], strlen(integers[i]));
+        minijson::detail::read_unquoted_value(buffer_context);
+        ASSERT_TRUE(minijson::detail::parse_unquoted_value(buffer_context).is_integer()) << integers[i];
+    }
+
+    const char* const non_integers[] = { "0.0,", "42.,", "1e2,", "-1E+0,", ".5,", "true,", "null," };
+    for (size_t i = 0; i < sizeof(non_integers) / sizeof(non_integers[0]); i++)
+    {
+        minijson::const_buffer_context buffer_context(non_integers[i], strlen(non_integers[i]));
+        minijson::detail::read_unquoted_value(buffer_context);
+        ASSERT_FALSE(minijson::detail::parse_unquoted_value(buffer_context).is_integer()) << non_integers[i];
+    }
+}
+
+TEST(minijson_reader_detail, parse_unquoted_value_out_of_range)
+{
+    char buffer[] = "-1e400]";
+    minijson::buffer_context buffer_context(buffer, sizeof(buffer));
+    minijson::detail::read_unquoted_value(buffer_context);
+
+    parse_unquoted_value_invalid_helper(buffer_context, 6);
+}
+
 TEST(minijson_reader_detail, read_value_object)
 {
     char buffer[] = "{...";
@@ -1368,91 +1816,439 @@ struct parse_dummy_consume
     }
 };
 
-TEST(minijson_reader, parse_object_truncated)
+template<typename Context>
+struct parse_collect_values
 {
-    using minijson::parse_error;
+    Context& context;
+    std::string& output;
 
-    char buffer[] = "{\"str\":\"val\",\"int\":42,\"null\":null}";
+    explicit parse_collect_values(Context& context, std::string& output) :
+        context(context),
+        output(output)
+    {
+    }
 
-    for (size_t i = sizeof(buffer) - 2; i < sizeof(buffer); i--)
+    void operator()(const char* field_name, minijson::value value)
     {
-        buffer[i] = 0;
-        minijson::const_buffer_context const_buffer_context(buffer, sizeof(buffer) - 1);
+        output += field_name;
+        output += ':';
+        operator()(value);
+    }
 
-        bool exception_thrown = false;
-        try
+    void operator()(minijson::value value)
+    {
+        if (value.type() == minijson::Object)
         {
-            minijson::parse_object(const_buffer_context, parse_dummy());
+            output += '{';
+            minijson::parse_object(context, *this);
+            output += '}';
         }
-        catch (const parse_error& e)
+        else if (value.type() == minijson::Array)
         {
-            exception_thrown = true;
-
-            switch (i)
-            {
-            case 0:  ASSERT_EQ(parse_error::EXPECTED_OPENING_BRACKET,          e.reason()); ASSERT_STREQ("Expected opening bracket", e.what()); break;
-            case 1:  ASSERT_EQ(parse_error::EXPECTED_OPENING_QUOTE,            e.reason()); break;
-            case 2:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 3:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 4:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 5:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 6:  ASSERT_EQ(parse_error::EXPECTED_COLON,                    e.reason()); ASSERT_STREQ("Expected colon", e.what()); break;
-            case 7:  ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 8:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 9:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 10: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 11: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 12: ASSERT_EQ(parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET, e.reason()); ASSERT_STREQ("Expected comma or closing bracket", e.what()); break;
-            case 13: ASSERT_EQ(parse_error::EXPECTED_OPENING_QUOTE,            e.reason()); break;
-            case 14: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 15: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 16: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 17: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 18: ASSERT_EQ(parse_error::EXPECTED_COLON,                    e.reason()); break;
-            case 19: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 20: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 21: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 22: ASSERT_EQ(parse_error::EXPECTED_OPENING_QUOTE,            e.reason()); break;
-            case 23: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 24: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 25: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 26: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 27: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
-            case 28: ASSERT_EQ(parse_error::EXPECTED_COLON,                    e.reason()); break;
-            case 29: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 30: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 31: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 32: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            case 33: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
-            default: FAIL();
-            }
+            output += '[';
+            minijson::parse_array(context, *this);
+            output += ']';
+        }
+        else
+        {
+            output += value.as_string();
+            output += ';';
         }
-
-        ASSERT_TRUE(exception_thrown);
     }
-}
+};
 
-TEST(minijson_reader, parse_array_truncated)
+TEST(minijson_reader, string_arena_empty_append)
 {
-    using minijson::parse_error;
+    // no chunk has been allocated yet
+    minijson::detail::string_arena arena;
+    arena.new_string();
+    arena.append("", 0);
+    ASSERT_EQ(NULL, arena.string());
+    ASSERT_EQ(0U, arena.chunk_count());
 
-    char buffer[] = "[\"val\",42,null]";
+    arena.append(0);
+    ASSERT_STREQ("", arena.string());
 
-    for (size_t i = sizeof(buffer) - 2; i < sizeof(buffer); i--)
+    // the first string decoded by istream_context is empty
     {
-        buffer[i] = 0;
-        minijson::const_buffer_context const_buffer_context(buffer, sizeof(buffer) - 1);
+        std::istringstream buffer("[\"\", \"x\"]");
+        minijson::istream_context context(buffer);
+        std::string output;
+        minijson::parse_array(context, parse_collect_values<minijson::istream_context>(context, output));
+        ASSERT_EQ(";x;", output);
+    }
+    {
+        std::istringstream buffer("{\"\":\"\"}");
+        minijson::istream_context context(buffer);
+        std::string output;
+        minijson::parse_object(context, parse_collect_values<minijson::istream_context>(context, output));
+        ASSERT_EQ(":;", output);
+    }
+}
 
-        bool exception_thrown = false;
-        try
-        {
-            minijson::parse_array(const_buffer_context, parse_dummy());
-        }
-        catch (const parse_error& e)
-        {
-            exception_thrown = true;
+TEST(minijson_reader, parse_object_pretty_printed)
+{
+    const std::string indent(40, ' ');
+    const std::string input =
+        "\r\n\t{\n" + indent + "\"a\" :\t1 ,\n" +
+        indent + indent + "\"b\"\n:\n[ \t\r\n" + indent + "true\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t," +
+        indent + "\"x\"  ,\v{ }" + indent + "]\n,\f\"c\":null" + indent + "\n}" + indent;
+    const char expected[] = "a:1;b:[true;x;{}]c:null;";
 
-            switch (i)
+    {
+        std::vector<char> buffer(input.begin(), input.end());
+        minijson::buffer_context buffer_context(&buffer[0], buffer.size());
+        std::string output;
+        minijson::parse_object(buffer_context, parse_collect_values<minijson::buffer_context>(buffer_context, output));
+        ASSERT_EQ(expected, output);
+    }
+    {
+        minijson::const_buffer_context const_buffer_context(input.data(), input.size());
+        std::string output;
+        minijson::parse_object(const_buffer_context, parse_collect_values<minijson::const_buffer_context>(const_buffer_context, output));
+        ASSERT_EQ(expected, output);
+    }
+    {
+        std::istringstream ss(input);
+        minijson::istream_context istream_context(ss);
+        std::string output;
+        minijson::parse_object(istream_context, parse_collect_values<minijson::istream_context>(istream_context, output));
+        ASSERT_EQ(expected, output);
+    }
+}
+
+TEST(minijson_reader, parse_array_trailing_whitespace_truncated)
+{
+    const std::string input = "[1," + std::string(70, ' ');
+    minijson::const_buffer_context const_buffer_context(input.data(), input.size());
+
+    try
+    {
+        minijson::parse_array(const_buffer_context, parse_dummy());
+        FAIL();
+    }
+    catch (const minijson::parse_error& parse_error)
+    {
+        ASSERT_EQ(minijson::parse_error::UNTERMINATED_VALUE, parse_error.reason());
+        ASSERT_EQ(input.size() - 1, parse_error.offset());
+    }
+}
+
+// a non-seekable stream buffer returning its input a few characters at a time, like a pipe
+class chunked_streambuf : public std::streambuf
+{
+private:
+
+    std::string m_input;
+    size_t m_offset;
+    size_t m_chunk_size;
+
+public:
+
+    explicit chunked_streambuf(const std::string& input, size_t chunk_size) :
+        m_input(input),
+        m_offset(0),
+        m_chunk_size(chunk_size)
+    {
+    }
+
+protected:
+
+    int_type underflow()
+    {
+        if (m_offset == m_input.size())
+        {
+            return traits_type::eof();
+        }
+
+        char* const chunk = &m_input[m_offset];
+        const size_t size = std::min(m_chunk_size, m_input.size() - m_offset);
+        setg(chunk, chunk, chunk + size);
+        m_offset += size;
+
+        return traits_type::to_int_type(*chunk);
+    }
+};
+
+TEST(minijson_reader, istream_context_blocks)
+{
+    const std::string indent(40, ' ');
+    std::string input = "{\n" + indent + "\"" + std::string(100, 's') + "\\n\" : [1, 2.5, true, null, \"\\u4F60\"]";
+    for (size_t i = 0; i < 20; i++)
+    {
+        input += ",\n" + indent + "\"k\":{\"a\" : \"" + std::string(i * 7, 'v') + "\"}";
+    }
+    input += "\n}";
+
+    std::string expected;
+    {
+        std::istringstream ss(input);
+        minijson::istream_context istream_context(ss, 1);
+        minijson::parse_object(istream_context, parse_collect_values<minijson::istream_context>(istream_context, expected));
+    }
+
+    const size_t block_sizes[] = { 0, 1, 2, 7, 64, minijson::istream_context::DEFAULT_BLOCK_SIZE };
+    const size_t chunk_sizes[] = { 1, 3, 100, 100000 };
+    for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++)
+    {
+        for (size_t j = 0; j < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); j++)
+        {
+            chunked_streambuf streambuf(input, chunk_sizes[j]);
+            std::istream stream(&streambuf);
+            minijson::istream_context istream_context(stream, block_sizes[i]);
+            std::string output;
+            minijson::parse_object(istream_context, parse_collect_values<minijson::istream_context>(istream_context, output));
+            ASSERT_EQ(expected, output);
+            ASSERT_EQ(input.size(), istream_context.read_offset());
+        }
+    }
+}
+
+TEST(minijson_reader, istream_context_stream_position)
+{
+    std::istringstream ss("[1, {\"a\": \"b\"}]{} trailing");
+    {
+        minijson::istream_context istream_context(ss);
+        minijson::parse_array(istream_context, parse_dummy_consume<minijson::istream_context>(istream_context));
+    }
+    {
+        minijson::istream_context istream_context(ss);
+        minijson::parse_object(istream_context, parse_dummy());
+    }
+
+    // everything after the parsed messages is left in the stream
+    ASSERT_TRUE(ss.good());
+    std::string rest;
+    std::getline(ss, rest);
+    ASSERT_EQ(" trailing", rest);
+}
+
+// a stream buffer that counts the bytes copied out of it with sgetn()
+class counting_stringbuf : public std::stringbuf
+{
+public:
+
+    size_t copied;
+
+    explicit counting_stringbuf(const std::string& input) :
+        std::stringbuf(input, std::ios_base::in),
+        copied(0)
+    {
+    }
+
+protected:
+
+    std::streamsize xsgetn(char* s, std::streamsize n)
+    {
+        const std::streamsize result = std::stringbuf::xsgetn(s, n);
+        copied += static_cast<size_t>(result);
+        return result;
+    }
+};
+
+TEST(minijson_reader, istream_context_many_messages)
+{
+    // NDJSON read from a single stream, with a context per message
+    const size_t message_count = 2000;
+    std::vector<std::string> messages;
+    std::string input;
+    for (size_t i = 0; i < message_count; i++)
+    {
+        std::ostringstream message;
+        message << "{\"id\":" << i << ",\"name\":\"" << std::string(i % 50, 'n') << "\",\"tags\":[\"a\",{\"b\":null}]}";
+        messages.push_back(message.str());
+        input += message.str() + "\n";
+    }
+
+    counting_stringbuf streambuf(input);
+    std::istream stream(&streambuf);
+    for (size_t i = 0; i < message_count; i++)
+    {
+        std::string expected;
+        {
+            minijson::const_buffer_context context(messages[i].data(), messages[i].size());
+            minijson::parse_object(context, parse_collect_values<minijson::const_buffer_context>(context, expected));
+        }
+
+        minijson::istream_context context(stream);
+        std::string output;
+        minijson::parse_object(context, parse_collect_values<minijson::istream_context>(context, output));
+        ASSERT_EQ(expected, output);
+    }
+
+    std::string rest;
+    std::getline(stream, rest);
+    ASSERT_EQ("", rest);
+    ASSERT_FALSE(std::getline(stream, rest));
+
+    // the input read ahead of each message and given back to the stream stays proportional
+    // to the size of the message, rather than to the block size
+    ASSERT_LE(streambuf.copied, 2 * input.size() + message_count * minijson::istream_context::INITIAL_FILL_SIZE);
+}
+
+TEST(minijson_reader, istream_context_eof)
+{
+    std::istringstream ss("[1");
+    minijson::istream_context istream_context(ss);
+    ASSERT_THROW(minijson::parse_array(istream_context, parse_dummy()), minijson::parse_error);
+    ASSERT_TRUE(ss.eof());
+    ASSERT_TRUE(ss.fail());
+}
+
+#ifdef MJR_MMAP_SUPPORTED
+
+// a temporary file, removed on destruction
+class temporary_file
+{
+private:
+
+    std::string m_path;
+
+public:
+
+    explicit temporary_file(const std::string& contents)
+    {
+        char path[] = "/tmp/minijson_reader_tests_XXXXXX";
+        const int fd = mkstemp(path);
+        EXPECT_NE(-1, fd);
+        EXPECT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+        close(fd);
+        m_path = path;
+    }
+
+    ~temporary_file()
+    {
+        unlink(m_path.c_str());
+    }
+
+    const std::string& path() const
+    {
+        return m_path;
+    }
+};
+
+TEST(minijson_reader, mmap_file_context)
+{
+    const temporary_file file("hello world.");
+    minijson::mmap_file_context mmap_file_context(file.path());
+    ASSERT_EQ(12U, mmap_file_context.length());
+    test_context_helper(mmap_file_context);
+}
+
+TEST(minijson_reader, mmap_file_context_empty)
+{
+    const temporary_file file("");
+    minijson::mmap_file_context mmap_file_context(file.path().c_str());
+    ASSERT_EQ(0U, mmap_file_context.length());
+    ASSERT_EQ(minijson::Null, mmap_file_context.toplevel_type());
+    ASSERT_EQ(0, mmap_file_context.read());
+}
+
+TEST(minijson_reader, mmap_file_context_page_sized)
+{
+    // no null terminator after the mapping: nothing may read past its end
+    const std::string contents = "[" + std::string(getpagesize() - 4, ' ') + "42]";
+    const temporary_file file(contents);
+    minijson::mmap_file_context mmap_file_context(file.path());
+    ASSERT_EQ(minijson::Array, mmap_file_context.toplevel_type());
+
+    std::string output;
+    minijson::parse_array(mmap_file_context, parse_collect_values<minijson::mmap_file_context>(mmap_file_context, output));
+    ASSERT_EQ("42;", output);
+}
+
+TEST(minijson_reader, mmap_file_context_missing_file)
+{
+    ASSERT_THROW(minijson::mmap_file_context("/nonexistent/minijson_reader_tests"), std::runtime_error);
+}
+
+#endif // MJR_MMAP_SUPPORTED
+
+TEST(minijson_reader, parse_object_truncated)
+{
+    using minijson::parse_error;
+
+    char buffer[] = "{\"str\":\"val\",\"int\":42,\"null\":null}";
+
+    for (size_t i = sizeof(buffer) - 2; i < sizeof(buffer); i--)
+    {
+        buffer[i] = 0;
+        minijson::const_buffer_context const_buffer_context(buffer, sizeof(buffer) - 1);
+
+        bool exception_thrown = false;
+        try
+        {
+            minijson::parse_object(const_buffer_context, parse_dummy());
+        }
+        catch (const parse_error& e)
+        {
+            exception_thrown = true;
+
+            switch (i)
+            {
+            case 0:  ASSERT_EQ(parse_error::EXPECTED_OPENING_BRACKET,          e.reason()); ASSERT_STREQ("Expected opening bracket", e.what()); break;
+            case 1:  ASSERT_EQ(parse_error::EXPECTED_OPENING_QUOTE,            e.reason()); break;
+            case 2:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 3:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 4:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 5:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 6:  ASSERT_EQ(parse_error::EXPECTED_COLON,                    e.reason()); ASSERT_STREQ("Expected colon", e.what()); break;
+            case 7:  ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 8:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 9:  ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 10: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 11: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 12: ASSERT_EQ(parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET, e.reason()); ASSERT_STREQ("Expected comma or closing bracket", e.what()); break;
+            case 13: ASSERT_EQ(parse_error::EXPECTED_OPENING_QUOTE,            e.reason()); break;
+            case 14: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 15: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 16: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 17: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 18: ASSERT_EQ(parse_error::EXPECTED_COLON,                    e.reason()); break;
+            case 19: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 20: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 21: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 22: ASSERT_EQ(parse_error::EXPECTED_OPENING_QUOTE,            e.reason()); break;
+            case 23: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 24: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 25: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 26: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 27: ASSERT_EQ(parse_error::EXPECTED_CLOSING_QUOTE,            e.reason()); break;
+            case 28: ASSERT_EQ(parse_error::EXPECTED_COLON,                    e.reason()); break;
+            case 29: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 30: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 31: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 32: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            case 33: ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
+            default: FAIL();
+            }
+        }
+
+        ASSERT_TRUE(exception_thrown);
+    }
+}
+
+TEST(minijson_reader, parse_array_truncated)
+{
+    using minijson::parse_error;
+
+    char buffer[] = "[\"val\",42,null]";
+
+    for (size_t i = sizeof(buffer) - 2; i < sizeof(buffer); i--)
+    {
+        buffer[i] = 0;
+        minijson::const_buffer_context const_buffer_context(buffer, sizeof(buffer) - 1);
+
+        bool exception_thrown = false;
+        try
+        {
+            minijson::parse_array(const_buffer_context, parse_dummy());
+        }
+        catch (const parse_error& e)
+        {
+            exception_thrown = true;
+
+            switch (i)
             {
             case 0:  ASSERT_EQ(parse_error::EXPECTED_OPENING_BRACKET,          e.reason()); break;
             case 1:  ASSERT_EQ(parse_error::UNTERMINATED_VALUE,                e.reason()); break;
@@ -1616,124 +2412,2381 @@ TEST(minijson_reader, parse_array_invalid)
         minijson::parse_error::EXCEEDED_NESTING_LIMIT, "Exceeded nesting limit (32)");
 }
 
-#if MJR_CPP11_SUPPORTED
-
-TEST(minijson_dispatch, present)
+template<typename Context>
+struct try_parse_dummy_consume
 {
-    bool handled[4] { };
-
-    minijson::dispatch("test2")
-        <<"test1">> [&]{ handled[0] = true; }
-        <<"test2">> [&]{ handled[1] = true; } // should "break" here
-        <<"test3">> [&]{ handled[2] = true; }
-        <<"test2">> [&]{ handled[3] = true; };
-
-    ASSERT_FALSE(handled[0]);
-    ASSERT_TRUE(handled[1]);
-    ASSERT_FALSE(handled[2]);
-    ASSERT_FALSE(handled[3]);
-}
+    Context& context;
 
-TEST(minijson_dispatch, absent)
-{
-    bool handled[3] { };
+    explicit try_parse_dummy_consume(Context& context) :
+        context(context)
+    {
+    }
 
-    minijson::dispatch("x")
-        <<"test1">> [&]{ handled[0] = true; }
-        <<"test2">> [&]{ handled[1] = true; }
-        <<"test3">> [&]{ handled[2] = true; };
+    void operator()(const char*, minijson::value value)
+    {
+        operator()(value);
+    }
 
-    ASSERT_FALSE(handled[0]);
-    ASSERT_FALSE(handled[1]);
-    ASSERT_FALSE(handled[2]);
-}
+    void operator()(minijson::value value)
+    {
+        // on failure, just return: the enclosing calls report the error
+        if (value.type() == minijson::Object)
+        {
+            minijson::try_parse_object(context, *this);
+        }
+        else if (value.type() == minijson::Array)
+        {
+            minijson::try_parse_array(context, *this);
+        }
+    }
+};
 
-TEST(minijson_dispatch, absent_with_any_handler)
+// try_parse_object and try_parse_array must fail exactly where parse_object and parse_array throw
+void try_parse_helper(const std::string& input)
 {
-    bool handled[4] { };
+    typedef minijson::const_buffer_context context_type;
 
-    using minijson::any;
-
-    minijson::dispatch("x")
-        <<"test1">> [&]{ handled[0] = true; }
-        <<"test2">> [&]{ handled[1] = true; }
-        <<"test3">> [&]{ handled[2] = true; }
-        <<any>>     [&]{ handled[3] = true; };
+    const bool array = !input.empty() && (input[0] == '[');
 
-    ASSERT_FALSE(handled[0]);
+    bool exception_thrown = false;
+    minijson::parse_error expected(minijson::parse_error::UNKNOWN, 0);
+    {
+        context_type context(input.data(), input.size());
+        try
+        {
+            if (array)
+            {
+                minijson::parse_array(context, parse_dummy_consume<context_type>(context));
+            }
+            else
+            {
+                minijson::parse_object(context, parse_dummy_consume<context_type>(context));
+            }
+        }
+        catch (const minijson::parse_error& e)
+        {
+            exception_thrown = true;
+            expected = e;
+        }
+    }
+
+    context_type context(input.data(), input.size());
+    const minijson::parse_status status = array ?
+        minijson::try_parse_array(context, try_parse_dummy_consume<context_type>(context)) :
+        minijson::try_parse_object(context, try_parse_dummy_consume<context_type>(context));
+
+    ASSERT_EQ(exception_thrown, status.failed()) << input;
+    if (exception_thrown)
+    {
+        ASSERT_EQ(expected.reason(), status.error().reason()) << input;
+        ASSERT_EQ(expected.offset(), status.error().offset()) << input;
+        ASSERT_STREQ(expected.what(), status.error().what()) << input;
+    }
+}
+
+TEST(minijson_reader, try_parse)
+{
+    const char* const inputs[] =
+    {
+        "{\"a\":[1,{\"b\":[true,null,\"\\u00e8\"]},-2.5e3],\"c\":{}}",
+        "[[[]],{},\"x\",[{\"y\":[0]}]]",
+        "{\"x\":8.2e+62738}",
+        "[0x1273]",
+        "{\"x\":nuxl}",
+        "{\"\\ufffx\":null}",
+        "[\"\\ud800\\uee00\"]",
+        "{\"\\x\":null}",
+        "{\"a\":[1,{\"b\":[true,nul]}]}",
+        "{\"a\":[1,{\"b\":[true,\"\\udc00\"]}]}",
+        "[{\"a\":[1,2,{\"b\":3,}]}]",
+        "{\"a\":[1,2 3]}",
+        "[1,[2,[3,[4]]]",
+        "{\"a\" 1}",
+        "x",
+        "",
+        "{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":["
+        "]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const std::string input = inputs[i];
+        for (size_t length = 0; length <= input.size(); length++) // every truncation too
+        {
+            try_parse_helper(input.substr(0, length));
+        }
+    }
+}
+
+TEST(minijson_reader, try_parse_nested_not_parsed)
+{
+    const char buffer[] = "{\"a\":{}}";
+    minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+
+    const minijson::parse_status status = minijson::try_parse_object(context, parse_dummy());
+    ASSERT_TRUE(status.failed());
+    ASSERT_EQ(minijson::parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED, status.error().reason());
+}
+
+template<typename Context>
+struct try_ignore_handler
+{
+    Context& context;
+    std::string& names;
+
+    explicit try_ignore_handler(Context& context, std::string& names) :
+        context(context),
+        names(names)
+    {
+    }
+
+    void operator()(const char* name, minijson::value)
+    {
+        names += name;
+        minijson::try_ignore(context);
+    }
+};
+
+TEST(minijson_reader, try_ignore)
+{
+    typedef minijson::const_buffer_context context_type;
+    {
+        const char buffer[] = "{\"a\":[1,{\"b\":2}],\"c\":3}";
+        context_type context(buffer, sizeof(buffer) - 1);
+
+        std::string names;
+        ASSERT_FALSE(minijson::try_parse_object(context, try_ignore_handler<context_type>(context, names)).failed());
+        ASSERT_EQ("ac", names);
+    }
+    {
+        const char buffer[] = "{\"a\":[1,{\"b\":2}},\"c\":3}";
+        context_type context(buffer, sizeof(buffer) - 1);
+
+        std::string names;
+        const minijson::parse_status status = minijson::try_parse_object(context, try_ignore_handler<context_type>(context, names));
+        ASSERT_TRUE(status.failed());
+        ASSERT_EQ(minijson::parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET, status.error().reason());
+        ASSERT_EQ(15U, status.error().offset());
+        ASSERT_EQ("a", names); // parsing stopped right after the handler that met the error
+    }
+    {
+        const char buffer[] = "{\"a\":[1,{\"b\":\"\\x";
+        context_type context(buffer, sizeof(buffer) - 1);
+
+        std::string names;
+        const minijson::parse_status status = minijson::try_parse_object(context, try_ignore_handler<context_type>(context, names));
+        ASSERT_TRUE(status.failed());
+        ASSERT_EQ(minijson::parse_error::EXPECTED_CLOSING_QUOTE, status.error().reason());
+    }
+    {
+        // only brackets and strings are looked at in ignored values
+        const char buffer[] = "{\"a\":[1,,{\"b\":x,}],\"c\":3}";
+        context_type context(buffer, sizeof(buffer) - 1);
+
+        std::string names;
+        ASSERT_FALSE(minijson::try_parse_object(context, try_ignore_handler<context_type>(context, names)).failed());
+        ASSERT_EQ("ac", names);
+    }
+}
+
+template<typename Context>
+struct ignore_a_handler
+{
+    Context& context;
+    std::string& names;
+
+    explicit ignore_a_handler(Context& context, std::string& names) :
+        context(context),
+        names(names)
+    {
+    }
+
+    void operator()(const char* name, minijson::value value)
+    {
+        names += name;
+        if (std::strcmp(name, "a") == 0)
+        {
+            minijson::ignore(context);
+        }
+        else
+        {
+            names += value.as_string();
+        }
+    }
+};
+
+TEST(minijson_reader, ignore_skips_subtree)
+{
+    // brackets, quotes and backslashes in strings, which must not fool the skipper wherever the
+    // 64-byte blocks it works on begin
+    const std::string subtree =
+        "{\"x\":\"a\\\"]}[{\\\\\", \"y\" : [1, {\"w\":\"\\\\\"}, [[]], \"]\\u005d\"], "
+        "\"\\\\\\\"}\":{}, \"v\":[\"{\",\"[\",\"\\\\\\\\\"]}";
+
+    for (size_t padding = 0; padding < 130; padding++)
+    {
+        const std::string input = "{\"a\":" + std::string(padding, ' ') + subtree + ",\"z\":\"1\"}";
+        {
+            std::vector<char> buffer(input.begin(), input.end());
+            minijson::buffer_context context(&buffer[0], buffer.size());
+            std::string names;
+            minijson::parse_object(context, ignore_a_handler<minijson::buffer_context>(context, names));
+            ASSERT_EQ("az1", names);
+
+            // nothing is written over the skipped subtree, past its opening bracket
+            ASSERT_EQ(subtree.substr(1), std::string(buffer.begin() + 6 + padding, buffer.begin() + 5 + padding + subtree.size()));
+        }
+        {
+            minijson::const_buffer_context context(input.data(), input.size());
+            std::string names;
+            minijson::parse_object(context, ignore_a_handler<minijson::const_buffer_context>(context, names));
+            ASSERT_EQ("az1", names);
+        }
+
+        const size_t block_sizes[] = { 1, 7, 64, 100 };
+        for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++)
+        {
+            std::istringstream stream(input);
+            minijson::istream_context context(stream, block_sizes[i]);
+            std::string names;
+            minijson::parse_object(context, ignore_a_handler<minijson::istream_context>(context, names));
+            ASSERT_EQ("az1", names);
+        }
+    }
+}
+
+TEST(minijson_reader, ignore_skips_escaped_brackets)
+{
+    // the skipper doesn't validate: a bracket escaped outside strings is skipped like any other
+    // escaped byte, whether or not it falls in a 64-byte block
+    std::string subtree = "[";
+    for (size_t i = 0; i < 10; i++)
+    {
+        subtree += "1,\\],{\\}},";
+    }
+    subtree += "2]";
+
+    for (size_t padding = 0; padding < 130; padding++)
+    {
+        const std::string input = "{\"a\":" + std::string(padding, ' ') + subtree + ",\"z\":\"1\"}";
+        {
+            minijson::const_buffer_context context(input.data(), input.size());
+            std::string names;
+            minijson::parse_object(context, ignore_a_handler<minijson::const_buffer_context>(context, names));
+            ASSERT_EQ("az1", names);
+        }
+        {
+            std::istringstream stream(input);
+            minijson::istream_context context(stream, 1);
+            std::string names;
+            minijson::parse_object(context, ignore_a_handler<minijson::istream_context>(context, names));
+            ASSERT_EQ("az1", names);
+        }
+    }
+}
+
+template<typename Context>
+struct ignore_unparsed_handler
+{
+    Context& context;
+    std::string& names;
+
+    explicit ignore_unparsed_handler(Context& context, std::string& names) :
+        context(context),
+        names(names)
+    {
+    }
+
+    void operator()(const char* name, minijson::value)
+    {
+        names += name;
+        if (std::strcmp(name, "c") == 0)
+        {
+            minijson::parse_array(context, minijson::ignore_unparsed(context, *this));
+        }
+    }
+
+    void operator()(minijson::value value)
+    {
+        names += value.as_string();
+    }
+};
+
+TEST(minijson_reader, ignore_unparsed)
+{
+    typedef minijson::const_buffer_context context_type;
+
+    const char buffer[] = "{\"a\":{\"b\":[1]},\"c\":[2,{},[3]],\"d\":4}";
+    {
+        context_type context(buffer, sizeof(buffer) - 1);
+        std::string names;
+        minijson::parse_object(context, minijson::ignore_unparsed(context, ignore_unparsed_handler<context_type>(context, names)));
+        ASSERT_EQ("ac2d", names);
+    }
+    {
+        context_type context(buffer, sizeof(buffer) - 1);
+        std::string names;
+        const minijson::parse_status status = minijson::try_parse_object(context, ignore_unparsed_handler<context_type>(context, names));
+        ASSERT_TRUE(status.failed());
+        ASSERT_EQ(minijson::parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED, status.error().reason());
+    }
+}
+
+TEST(minijson_dispatch_table, find)
+{
+    const char* const keys[] = { "id", "name", "", "n\xC3\xA4me", "name", "tags" };
+    const minijson::dispatch_table table(keys);
+    const size_t not_found = minijson::dispatch_table::NOT_FOUND;
+
+    ASSERT_EQ(5U, table.size()); // duplicates are only counted once
+    ASSERT_EQ(0U, table.find("id"));
+    ASSERT_EQ(1U, table.find("name")); // the first one wins
+    ASSERT_EQ(2U, table.find(""));
+    ASSERT_EQ(3U, table.find("n\xC3\xA4me"));
+    ASSERT_EQ(5U, table.find(std::string("tags")));
+    ASSERT_EQ(not_found, table.find("i"));
+    ASSERT_EQ(not_found, table.find("ids"));
+    ASSERT_EQ(not_found, table.find("Name"));
+    ASSERT_EQ(not_found, table.find(std::string("tag\0s", 5)));
+}
+
+TEST(minijson_dispatch_table, only_empty_key)
+{
+    // no key has any characters to store
+    const char* const keys[] = { "", "" };
+    const minijson::dispatch_table table(keys);
+    const size_t not_found = minijson::dispatch_table::NOT_FOUND;
+
+    ASSERT_EQ(1U, table.size());
+    ASSERT_EQ(0U, table.find(""));
+    ASSERT_EQ(0U, table.find(std::string()));
+    ASSERT_EQ(not_found, table.find("a"));
+}
+
+TEST(minijson_dispatch_table, many_keys)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 1000; i++)
+    {
+        std::ostringstream key;
+        key << "field" << i;
+        keys.push_back(key.str());
+    }
+
+    const minijson::dispatch_table table(keys);
+    const size_t not_found = minijson::dispatch_table::NOT_FOUND;
+
+    ASSERT_EQ(1000U, table.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        ASSERT_EQ(i, table.find(keys[i].c_str()));
+    }
+    ASSERT_EQ(not_found, table.find("field1000"));
+
+    const minijson::dispatch_table empty((std::vector<std::string>()));
+    ASSERT_EQ(0U, empty.size());
+    ASSERT_EQ(not_found, empty.find("field0"));
+}
+
+// appends a description of a field (or an element, if name is NULL) to events
+void record_event(std::string& events, size_t nesting_level, const char* name, const minijson::value& value)
+{
+    std::ostringstream event;
+    event << nesting_level << ' ' << ((name != NULL) ? name : "-") << ' ' << value.type() << ' ' << value.as_string() << ';';
+    events += event.str();
+}
+
+template<typename Context>
+struct pull_recorder
+{
+    Context& context;
+    std::string& events;
+    size_t nesting_level;
+
+    explicit pull_recorder(Context& context, std::string& events, size_t nesting_level) :
+        context(context),
+        events(events),
+        nesting_level(nesting_level)
+    {
+    }
+
+    void operator()(const char* name, minijson::value value)
+    {
+        record_event(events, nesting_level, name, value);
+        parse_nested(value);
+    }
+
+    void operator()(minijson::value value)
+    {
+        record_event(events, nesting_level, NULL, value);
+        parse_nested(value);
+    }
+
+    void parse_nested(minijson::value value)
+    {
+        if (value.type() == minijson::Object)
+        {
+            minijson::parse_object(context, pull_recorder(context, events, nesting_level + 1));
+        }
+        else if (value.type() == minijson::Array)
+        {
+            minijson::parse_array(context, pull_recorder(context, events, nesting_level + 1));
+        }
+    }
+};
+
+struct push_recorder
+{
+    const minijson::push_parser<push_recorder>* const* parser;
+    std::string* events;
+
+    explicit push_recorder(const minijson::push_parser<push_recorder>* const* parser, std::string* events) :
+        parser(parser),
+        events(events)
+    {
+    }
+
+    void operator()(const char* name, minijson::value value)
+    {
+        record_event(*events, (*parser)->nesting_level(), name, value);
+    }
+
+    void operator()(minijson::value value)
+    {
+        record_event(*events, (*parser)->nesting_level(), NULL, value);
+    }
+};
+
+// feeds input to a push parser in chunks of the given sizes (the last one is repeated)
+minijson::parse_status push_parse(const std::string& input, const std::vector<size_t>& chunk_sizes, std::string& events, bool& done)
+{
+    const minijson::push_parser<push_recorder>* parser_pointer = NULL;
+    minijson::push_parser<push_recorder> parser(push_recorder(&parser_pointer, &events));
+    parser_pointer = &parser;
+
+    size_t offset = 0;
+    for (size_t i = 0; offset < input.size(); i++)
+    {
+        const size_t size = std::min(chunk_sizes[std::min(i, chunk_sizes.size() - 1)], input.size() - offset);
+        size_t consumed;
+        const minijson::parse_status status = parser.try_feed(input.data() + offset, size, consumed);
+        if (status.failed())
+        {
+            done = false;
+            return status;
+        }
+        offset += consumed;
+        if (consumed < size)
+        {
+            break;
+        }
+    }
+
+    EXPECT_EQ(offset, parser.offset());
+    done = parser.done();
+
+    return minijson::parse_status();
+}
+
+TEST(minijson_push_parser, same_events)
+{
+    const char* const inputs[] =
+    {
+        "{\"a\":[1,{\"b\":[true,null,\"\\u00e8\"]},-2.5e3],\"c\":{}, \"\\ud83d\\ude00\\\"\" : \"x\\\\y\\/\\n\"}",
+        "[[[]],{},\"x\",[{\"y\":[0]}], false ,\"\", 12345678901234567890, 0.1e-2]",
+        " \t\r\n{ \"k\" \n: \n[ ] \n} ",
+        "[]",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const std::string input = inputs[i];
+
+        std::string expected;
+        {
+            minijson::const_buffer_context context(input.data(), input.size());
+            if (input.find('{') < input.find('['))
+            {
+                minijson::parse_object(context, pull_recorder<minijson::const_buffer_context>(context, expected, 1));
+            }
+            else
+            {
+                minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, expected, 1));
+            }
+        }
+
+        // in chunks of every size
+        for (size_t chunk_size = 1; chunk_size <= input.size(); chunk_size++)
+        {
+            std::string events;
+            bool done;
+            ASSERT_FALSE(push_parse(input, std::vector<size_t>(1, chunk_size), events, done).failed());
+            ASSERT_TRUE(done) << input;
+            ASSERT_EQ(expected, events) << input << " " << chunk_size;
+        }
+
+        // split in two chunks anywhere, possibly empty
+        for (size_t split = 0; split <= input.size(); split++)
+        {
+            std::vector<size_t> chunk_sizes;
+            chunk_sizes.push_back(split);
+            chunk_sizes.push_back(input.size());
+
+            std::string events;
+            bool done;
+            ASSERT_FALSE(push_parse(input, chunk_sizes, events, done).failed());
+            ASSERT_TRUE(done) << input;
+            ASSERT_EQ(expected, events) << input << " " << split;
+        }
+    }
+}
+
+TEST(minijson_push_parser, message_end)
+{
+    std::string events;
+    const minijson::push_parser<push_recorder>* parser_pointer = NULL;
+    minijson::push_parser<push_recorder> parser(push_recorder(&parser_pointer, &events));
+    parser_pointer = &parser;
+
+    ASSERT_EQ(4U, parser.feed("[1, ", 4));
+    ASSERT_FALSE(parser.done());
+    ASSERT_EQ(2U, parser.feed("2]{}", 4)); // the rest belongs to the next message
+    ASSERT_TRUE(parser.done());
+    ASSERT_EQ(0U, parser.feed("{}", 2));
+    ASSERT_EQ(6U, parser.offset());
+    ASSERT_EQ("1 - 1 1;1 - 1 2;", events); // nesting level, name, type (Number) and value
+}
+
+TEST(minijson_push_parser, errors)
+{
+    // the same errors as parse_object and parse_array, at the same offsets
+    const char* const inputs[] =
+    {
+        "{\"x\":8.2e+62738}",
+        "[0x1273]",
+        "{\"x\":nuxl}",
+        "{\"\\ufffx\":null}",
+        "[\"\\ud800\\uee00\"]",
+        "{\"\\ud800\":null}",
+        "[\"\\ud800x\"]",
+        "[\"\\ud800\\n\"]",
+        "[\"\\ud800\\\\\"]",
+        "[\"\\ud800\\\"\"]",
+        "{\"\\x\":null}",
+        "{\"a\":[1,{\"b\":[true,nul]}]}",
+        "[{\"a\":[1,2,{\"b\":3,}]}]",
+        "{\"a\":[1,2 3]}",
+        "{\"a\":[1,2}}",
+        "{\"a\" 1}",
+        "{1:2}",
+        "x",
+        "{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":["
+        "]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const std::string input = inputs[i];
+
+        std::string expected_events;
+        minijson::const_buffer_context context(input.data(), input.size());
+        minijson::parse_error expected(minijson::parse_error::UNKNOWN, 0);
+        try
+        {
+            if (input[0] == '[')
+            {
+                minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, expected_events, 1));
+            }
+            else
+            {
+                minijson::parse_object(context, pull_recorder<minijson::const_buffer_context>(context, expected_events, 1));
+            }
+        }
+        catch (const minijson::parse_error& e)
+        {
+            expected = e;
+        }
+        ASSERT_NE(minijson::parse_error::UNKNOWN, expected.reason()) << input;
+
+        for (size_t chunk_size = 1; chunk_size <= input.size(); chunk_size++)
+        {
+            std::string events;
+            bool done;
+            const minijson::parse_status status = push_parse(input, std::vector<size_t>(1, chunk_size), events, done);
+            ASSERT_TRUE(status.failed()) << input;
+            ASSERT_EQ(expected.reason(), status.error().reason()) << input;
+            ASSERT_EQ(expected.offset(), status.error().offset()) << input;
+            ASSERT_EQ(expected_events, events) << input;
+        }
+    }
+
+    // the error is reported again by the next calls
+    std::string events;
+    const minijson::push_parser<push_recorder>* parser_pointer = NULL;
+    minijson::push_parser<push_recorder> parser(push_recorder(&parser_pointer, &events));
+    parser_pointer = &parser;
+    ASSERT_THROW(parser.feed("[1,}", 4), minijson::parse_error);
+    ASSERT_THROW(parser.feed("]", 1), minijson::parse_error);
+}
+
+// walks the current object or array with a cursor, recording the events in the same format as pull_recorder
+template<typename Context>
+void cursor_walk(minijson::cursor<Context>& cursor, std::string& events)
+{
+    const bool object = (cursor.peek_type() == minijson::Object);
+    cursor.enter();
+    while (cursor.next())
+    {
+        const char* const name = object ? cursor.key() : NULL;
+        const minijson::value_type type = cursor.peek_type();
+        if ((type == minijson::Object) || (type == minijson::Array))
+        {
+            record_event(events, cursor.depth(), name, minijson::value(type));
+            cursor_walk(cursor, events);
+        }
+        else
+        {
+            record_event(events, cursor.depth(), name, cursor.value());
+        }
+    }
+}
+
+TEST(minijson_cursor, same_events)
+{
+    const char* const inputs[] =
+    {
+        "{\"a\":[1,{\"b\":[true,null,\"\\u00e8\"]},-2.5e3],\"c\":{}, \"\\ud83d\\ude00\\\"\" : \"x\\\\y\\/\\n\"}",
+        "[[[]],{},\"x\",[{\"y\":[0]}], false ,\"\", 12345678901234567890, 0.1e-2]",
+        " \t\r\n{ \"k\" \n: \n[ ] \n} ",
+        "[]",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const std::string input = inputs[i];
+
+        std::string expected;
+        {
+            minijson::const_buffer_context context(input.data(), input.size());
+            if (input.find('{') < input.find('['))
+            {
+                minijson::parse_object(context, pull_recorder<minijson::const_buffer_context>(context, expected, 1));
+            }
+            else
+            {
+                minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, expected, 1));
+            }
+        }
+
+        {
+            std::string events;
+            std::vector<char> buffer(input.begin(), input.end());
+            minijson::buffer_context context(&buffer[0], buffer.size());
+            minijson::cursor<minijson::buffer_context> cursor(context);
+            cursor_walk(cursor, events);
+            ASSERT_EQ(expected, events) << input;
+            ASSERT_FALSE(cursor.next());
+        }
+
+        {
+            std::string events;
+            minijson::const_buffer_context context(input.data(), input.size());
+            minijson::cursor<minijson::const_buffer_context> cursor(context);
+            cursor_walk(cursor, events);
+            ASSERT_EQ(expected, events) << input;
+        }
+
+        {
+            std::string events;
+            std::istringstream stream(input);
+            minijson::istream_context context(stream);
+            minijson::cursor<minijson::istream_context> cursor(context);
+            cursor_walk(cursor, events);
+            ASSERT_EQ(expected, events) << input;
+        }
+    }
+}
+
+TEST(minijson_cursor, skip)
+{
+    const char input[] = "{\"id\":7,\"tags\":[\"a\",{\"b\":[1,2]}],\"point\":{\"x\":1.5,\"y\":-2},\"name\":\"n\",\"z\":null}";
+    minijson::const_buffer_context context(input, sizeof(input) - 1);
+    minijson::cursor<minijson::const_buffer_context> cursor(context);
+
+    long id = 0;
+    double x = 0;
+    std::string name;
+
+    cursor.enter();
+    while (cursor.next())
+    {
+        if (strcmp(cursor.key(), "id") == 0)
+        {
+            id = cursor.value().as_long();
+        }
+        else if (strcmp(cursor.key(), "point") == 0)
+        {
+            cursor.enter();
+            ASSERT_EQ(2U, cursor.depth());
+            while (cursor.next())
+            {
+                if (strcmp(cursor.key(), "x") == 0)
+                {
+                    x = cursor.value().as_double();
+                }
+            }
+            ASSERT_EQ(1U, cursor.depth());
+        }
+        else if (strcmp(cursor.key(), "name") == 0)
+        {
+            ASSERT_EQ(minijson::String, cursor.peek_type());
+            name = cursor.value().as_string();
+        }
+        else if (strcmp(cursor.key(), "z") == 0)
+        {
+            ASSERT_EQ(minijson::Null, cursor.peek_type());
+            cursor.skip();
+        }
+        else
+        {
+            ASSERT_EQ(minijson::Array, cursor.value().type()); // skipped
+        }
+    }
+
+    ASSERT_EQ(7, id);
+    ASSERT_EQ(1.5, x);
+    ASSERT_EQ("n", name);
+    ASSERT_EQ(0U, cursor.depth());
+    ASSERT_EQ(sizeof(input) - 1, context.read_offset());
+    ASSERT_THROW(cursor.value(), std::logic_error);
+}
+
+struct cursor_walk_handler
+{
+    minijson::const_buffer_context& context;
+    std::string& events;
+
+    explicit cursor_walk_handler(minijson::const_buffer_context& context, std::string& events) :
+        context(context),
+        events(events)
+    {
+    }
+
+    void operator()(const char* name, minijson::value value)
+    {
+        if (value.type() == minijson::Array)
+        {
+            minijson::cursor<minijson::const_buffer_context> cursor(context);
+            cursor_walk(cursor, events);
+        }
+        else
+        {
+            record_event(events, 0, name, value);
+        }
+    }
+};
+
+TEST(minijson_cursor, nested)
+{
+    const char input[] = "{\"a\":1,\"b\":[2,{\"c\":3}],\"d\":4}";
+    minijson::const_buffer_context context(input, sizeof(input) - 1);
+
+    std::string events;
+    minijson::parse_object(context, cursor_walk_handler(context, events));
+    ASSERT_EQ("0 a 1 1;1 - 1 2;1 - 3 ;2 c 1 3;0 d 1 4;", events); // nesting level, name, type and value
+}
+
+TEST(minijson_cursor, errors)
+{
+    // the same errors as parse_object and parse_array, at the same offsets
+    const char* const inputs[] =
+    {
+        "{\"x\":8.2e+62738}",
+        "[0x1273]",
+        "{\"x\":nuxl}",
+        "[\"\\ud800x\"]",
+        "{\"a\":[1,{\"b\":[true,nul]}]}",
+        "[{\"a\":[1,2,{\"b\":3,}]}]",
+        "{\"a\":[1,2 3]}",
+        "{\"a\":[1,2}}",
+        "{\"a\" 1}",
+        "{1:2}",
+        "x",
+        "[1,2",
+        "{\"a\":",
+        "{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":["
+        "]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const std::string input = inputs[i];
+
+        std::string expected_events;
+        minijson::parse_error expected(minijson::parse_error::UNKNOWN, 0);
+        try
+        {
+            minijson::const_buffer_context context(input.data(), input.size());
+            if (input[0] == '[')
+            {
+                minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, expected_events, 1));
+            }
+            else
+            {
+                minijson::parse_object(context, pull_recorder<minijson::const_buffer_context>(context, expected_events, 1));
+            }
+        }
+        catch (const minijson::parse_error& e)
+        {
+            expected = e;
+        }
+        ASSERT_NE(minijson::parse_error::UNKNOWN, expected.reason()) << input;
+
+        std::string events;
+        minijson::const_buffer_context context(input.data(), input.size());
+        minijson::cursor<minijson::const_buffer_context> cursor(context);
+        try
+        {
+            cursor_walk(cursor, events);
+            FAIL() << input;
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(expected.reason(), e.reason()) << input;
+            ASSERT_EQ(expected.offset(), e.offset()) << input;
+        }
+        ASSERT_EQ(expected_events, events) << input;
+    }
+}
+
+TEST(minijson_cursor, skip_strings)
+{
+    const char* const inputs[] = { "[\"a\\\"]\",1]", "[\"\\\\\",1]", "[\"\x01\\u0041\",1]" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const std::string input = inputs[i];
+
+        std::istringstream stream(input);
+        minijson::istream_context istream_context(stream);
+        minijson::cursor<minijson::istream_context> istream_cursor(istream_context);
+        istream_cursor.enter();
+        ASSERT_TRUE(istream_cursor.next());
+        ASSERT_TRUE(istream_cursor.next());
+        ASSERT_EQ(1, istream_cursor.value().as_long()) << input;
+
+        minijson::const_buffer_context buffer_context(input.data(), input.size());
+        minijson::cursor<minijson::const_buffer_context> buffer_cursor(buffer_context);
+        buffer_cursor.enter();
+        ASSERT_TRUE(buffer_cursor.next());
+        ASSERT_TRUE(buffer_cursor.next());
+        ASSERT_EQ(1, buffer_cursor.value().as_long()) << input;
+    }
+
+    const char truncated[] = "[\"abc\\\"";
+    minijson::const_buffer_context context(truncated, sizeof(truncated) - 1);
+    minijson::cursor<minijson::const_buffer_context> cursor(context);
+    cursor.enter();
+    ASSERT_TRUE(cursor.next());
+    try
+    {
+        cursor.skip();
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXPECTED_CLOSING_QUOTE, e.reason());
+        ASSERT_EQ(sizeof(truncated) - 2, e.offset());
+    }
+}
+
+// returns the value at the given path as a string, "object", "array", or "none"
+std::string find_path(const std::string& input, const char* path)
+{
+    minijson::const_buffer_context context(input.data(), input.size());
+    minijson::value value;
+    if (!minijson::find(context, path, value))
+    {
+        return "none";
+    }
+
+    switch (value.type())
+    {
+    case minijson::Object:
+        minijson::ignore(context);
+        return "object";
+    case minijson::Array:
+        minijson::ignore(context);
+        return "array";
+    default:
+        return value.as_string();
+    }
+}
+
+TEST(minijson_find, paths)
+{
+    const std::string input =
+        "{\"k1\":\"a\",\"k4\":[\"a\",\"b\",{\"c\":[1,2,3,4]}],\"k5\":{\"u\":\"z\",\"p\":null},"
+        "\"a/b\":1,\"m~n\":2,\"\":3,\"e\\u0073c\":true}";
+
+    ASSERT_EQ("a", find_path(input, "/k1"));
+    ASSERT_EQ("b", find_path(input, "/k4/1"));
+    ASSERT_EQ("4", find_path(input, "/k4/2/c/3"));
+    ASSERT_EQ("z", find_path(input, "/k5/u"));
+    ASSERT_EQ("null", find_path(input, "/k5/p"));
+    ASSERT_EQ("1", find_path(input, "/a~1b"));
+    ASSERT_EQ("2", find_path(input, "/m~0n"));
+    ASSERT_EQ("3", find_path(input, "/"));
+    ASSERT_EQ("true", find_path(input, "/esc"));
+    ASSERT_EQ("object", find_path(input, ""));
+    ASSERT_EQ("array", find_path(input, "/k4"));
+    ASSERT_EQ("object", find_path(input, "/k4/2"));
+
+    ASSERT_EQ("b", find_path(input, ".k4[1]"));
+    ASSERT_EQ("b", find_path(input, ".k4.1"));
+    ASSERT_EQ("4", find_path(input, ".k4[2].c[3]"));
+    ASSERT_EQ("z", find_path(input, ".k5.u"));
+    ASSERT_EQ("object", find_path(input, "."));
+
+    ASSERT_EQ("none", find_path(input, "/k2"));
+    ASSERT_EQ("none", find_path(input, "/k4/3"));
+    ASSERT_EQ("none", find_path(input, "/k4/x"));
+    ASSERT_EQ("none", find_path(input, "/k4/-1"));
+    ASSERT_EQ("none", find_path(input, "/k1/0"));
+    ASSERT_EQ("none", find_path(input, "/k5/u/v"));
+
+    ASSERT_EQ("y", find_path("[\"x\",[true,\"y\"]]", ".[1][1]"));
+    ASSERT_EQ("y", find_path("[\"x\",[true,\"y\"]]", "/1/1"));
+}
+
+TEST(minijson_find, nested)
+{
+    const char input[] = "{\"a\":{\"b\":[1,2]},\"c\":3}";
+    minijson::const_buffer_context context(input, sizeof(input) - 1);
+
+    minijson::value value;
+    ASSERT_TRUE(minijson::find(context, "/a/b", value));
+    ASSERT_EQ(minijson::Array, value.type());
+
+    std::string events;
+    minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, events, 1));
+    ASSERT_EQ("1 - 1 1;1 - 1 2;", events);
+    ASSERT_EQ(15U, context.read_offset()); // parsing stops right after the value found
+}
+
+TEST(minijson_find, path_index)
+{
+    const size_t max = static_cast<size_t>(-1);
+    std::string max_digits;
+    for (size_t n = max; n != 0; n /= 10)
+    {
+        max_digits.insert(max_digits.begin(), static_cast<char>('0' + n % 10));
+    }
+
+    size_t index = 0;
+    ASSERT_TRUE(minijson::detail::parse_path_index("0", index));
+    ASSERT_EQ(0U, index);
+    ASSERT_TRUE(minijson::detail::parse_path_index("0042", index));
+    ASSERT_EQ(42U, index);
+    ASSERT_TRUE(minijson::detail::parse_path_index(max_digits, index));
+    ASSERT_EQ(max, index);
+
+    std::string too_large = max_digits;
+    too_large[too_large.size() - 1]++; // max + 1
+    ASSERT_FALSE(minijson::detail::parse_path_index(too_large, index));
+    ASSERT_FALSE(minijson::detail::parse_path_index(max_digits + "0", index));
+    ASSERT_FALSE(minijson::detail::parse_path_index("1" + max_digits, index));
+    ASSERT_FALSE(minijson::detail::parse_path_index("", index));
+    ASSERT_FALSE(minijson::detail::parse_path_index("1a", index));
+
+    // an index that wraps around must not find a value
+    ASSERT_EQ("none", find_path("[\"a\",\"b\"]", "/18446744073709551617")); // 2^64 + 1
+}
+
+TEST(minijson_find, errors)
+{
+    // the input is parsed up to the value found
+    minijson::value value;
+    const char valid_prefix[] = "{\"a\":1,\"b\":2,]";
+    minijson::const_buffer_context context1(valid_prefix, sizeof(valid_prefix) - 1);
+    ASSERT_TRUE(minijson::find(context1, "/b", value));
+    ASSERT_EQ(2, value.as_long());
+
+    const char invalid[] = "{\"a\":1 \"b\":2}";
+    minijson::const_buffer_context context2(invalid, sizeof(invalid) - 1);
+    try
+    {
+        minijson::find(context2, "/b", value);
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET, e.reason());
+        ASSERT_EQ(7U, e.offset());
+    }
+}
+
+struct key_handler
+{
+    std::vector<std::string>& names;
+    std::vector<size_t>& lengths;
+    std::vector<uint32_t>& hashes;
+
+    explicit key_handler(std::vector<std::string>& names, std::vector<size_t>& lengths, std::vector<uint32_t>& hashes) :
+        names(names),
+        lengths(lengths),
+        hashes(hashes)
+    {
+    }
+
+    void operator()(const minijson::key& name, minijson::value)
+    {
+        names.push_back(name.name());
+        lengths.push_back(name.length());
+        hashes.push_back(name.hash());
+    }
+};
+
+TEST(minijson_reader, parse_object_key)
+{
+    const char buffer[] = "{\"a\":1, \"\":2, \"f\\u00e4\\\"ld\":3, \"field\":4}";
+    minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+
+    std::vector<std::string> names;
+    std::vector<size_t> lengths;
+    std::vector<uint32_t> hashes;
+    minijson::parse_object(context, key_handler(names, lengths, hashes));
+
+    ASSERT_EQ(4U, names.size());
+    ASSERT_EQ("a", names[0]);
+    ASSERT_EQ("", names[1]);
+    ASSERT_EQ("f\xC3\xA4\"ld", names[2]); // the hash is the one of the decoded name
+    ASSERT_EQ("field", names[3]);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        ASSERT_EQ(names[i].size(), lengths[i]);
+        ASSERT_EQ(minijson::detail::runtime_key_hash(names[i].data(), names[i].size()), hashes[i]);
+    }
+
+    const char* const keys[] = { "x", "f\xC3\xA4\"ld" };
+    const minijson::dispatch_table table(keys);
+    ASSERT_EQ(1U, table.find(minijson::key(names[2].c_str())));
+
+    const minijson::key name("field");
+    ASSERT_EQ(0, std::strcmp("field", name)); // converts to const char*
+}
+
+struct string_ref_handler
+{
+    std::string& names;
+
+    explicit string_ref_handler(std::string& names) :
+        names(names)
+    {
+    }
+
+    void operator()(const std::string& name, minijson::value)
+    {
+        names += name;
+    }
+};
+
+struct string_handler
+{
+    std::string& names;
+
+    explicit string_handler(std::string& names) :
+        names(names)
+    {
+    }
+
+    void operator()(std::string name, minijson::value)
+    {
+        names += name;
+    }
+};
+
+TEST(minijson_reader, parse_object_string_handler)
+{
+    const char buffer[] = "{\"a\":1, \"b\":{\"c\":2}, \"d\":3}";
+
+    std::string names;
+    minijson::const_buffer_context context1(buffer, sizeof(buffer) - 1);
+    minijson::parse_object(context1, minijson::ignore_unparsed(context1, string_ref_handler(names)));
+    ASSERT_EQ("abd", names);
+
+    names.clear();
+    minijson::const_buffer_context context2(buffer, sizeof(buffer) - 1);
+    minijson::parse_object(context2, minijson::ignore_unparsed(context2, string_handler(names)));
+    ASSERT_EQ("abd", names);
+}
+
+template<typename Context>
+void parse_object_key_digest_helper(Context& context, const std::vector<std::string>& expected)
+{
+    std::vector<std::string> names;
+    std::vector<size_t> lengths;
+    std::vector<uint32_t> hashes;
+    minijson::parse_object(context, minijson::ignore_unparsed(context, key_handler(names, lengths, hashes)));
+
+    ASSERT_EQ(expected, names);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        ASSERT_EQ(names[i].size(), lengths[i]);
+        ASSERT_EQ(minijson::detail::runtime_key_hash(names[i].data(), names[i].size()), hashes[i]);
+    }
+}
+
+TEST(minijson_reader, parse_object_key_digest)
+{
+#if MJR_CPP11_SUPPORTED
+    // the parser computes the length and the hash of the names passed to these handlers
+    ASSERT_TRUE(minijson::detail::takes_key<key_handler>::value);
+    ASSERT_TRUE((minijson::detail::takes_key<minijson::detail::ignore_unparsed<minijson::const_buffer_context, key_handler> >::value));
+    ASSERT_TRUE(minijson::detail::takes_key<void (*)(const minijson::key&, minijson::value)>::value);
+#endif
+    ASSERT_FALSE(minijson::detail::takes_key<string_handler>::value);
+    ASSERT_FALSE(minijson::detail::takes_key<parse_collect_values<minijson::const_buffer_context> >::value);
+    ASSERT_FALSE(minijson::detail::takes_key<void (*)(const char*, minijson::value)>::value);
+
+    const std::string long_name(100, 'n');
+    const std::string input =
+        "{\"a\":1, \"\":2, \"esc\\\"\\\\\\/\\b\\f\\n\\r\\tape\":3, \"\\u00e4\\ud834\\udd1e\\u0041\":{\"x\":[]}, "
+        "\"" + long_name + "\\n" + long_name + "\":4}";
+
+    std::vector<std::string> expected;
+    expected.push_back("a");
+    expected.push_back("");
+    expected.push_back("esc\"\\/\b\f\n\r\tape");
+    expected.push_back("\xC3\xA4\xF0\x9D\x84\x9E" "A");
+    expected.push_back(long_name + "\n" + long_name);
+
+    {
+        minijson::const_buffer_context context(input.data(), input.size());
+        parse_object_key_digest_helper(context, expected);
+    }
+    {
+        std::vector<char> buffer(input.begin(), input.end());
+        minijson::buffer_context context(&buffer[0], buffer.size());
+        parse_object_key_digest_helper(context, expected);
+    }
+    {
+        std::istringstream buffer(input);
+        minijson::istream_context context(buffer);
+        parse_object_key_digest_helper(context, expected);
+    }
+}
+
+struct dispatch_table_handler
+{
+    const minijson::dispatch_table& table;
+    long& sum;
+    std::string& unknown;
+
+    explicit dispatch_table_handler(const minijson::dispatch_table& table, long& sum, std::string& unknown) :
+        table(table),
+        sum(sum),
+        unknown(unknown)
+    {
+    }
+
+    void operator()(const char* name, minijson::value value)
+    {
+        switch (table.find(name))
+        {
+        case 0: sum += value.as_long(); break;
+        case 1: sum += 10 * value.as_long(); break;
+        default: unknown += name;
+        }
+    }
+};
+
+TEST(minijson_dispatch_table, parse_object)
+{
+    const char* const keys[] = { "a", "b" };
+    const minijson::dispatch_table table(keys); // shared by all the messages
+
+    const char* const messages[] = { "{\"a\":1,\"b\":2,\"c\":3}", "{\"b\":4,\"d\":5,\"a\":6}" };
+    const long sums[] = { 21, 46 };
+    const char* const unknowns[] = { "c", "d" };
+    for (size_t i = 0; i < 2; i++)
+    {
+        minijson::const_buffer_context context(messages[i], std::strlen(messages[i]));
+        long sum = 0;
+        std::string unknown;
+        minijson::parse_object(context, dispatch_table_handler(table, sum, unknown));
+        ASSERT_EQ(sums[i], sum);
+        ASSERT_EQ(unknowns[i], unknown);
+    }
+}
+
+#if MJR_CPP11_SUPPORTED
+
+TEST(minijson_dispatch, present)
+{
+    bool handled[4] { };
+
+    minijson::dispatch("test2")
+        <<"test1">> [&]{ handled[0] = true; }
+        <<"test2">> [&]{ handled[1] = true; } // should "break" here
+        <<"test3">> [&]{ handled[2] = true; }
+        <<"test2">> [&]{ handled[3] = true; };
+
+    ASSERT_FALSE(handled[0]);
+    ASSERT_TRUE(handled[1]);
+    ASSERT_FALSE(handled[2]);
+    ASSERT_FALSE(handled[3]);
+}
+
+TEST(minijson_dispatch, absent)
+{
+    bool handled[3] { };
+
+    minijson::dispatch("x")
+        <<"test1">> [&]{ handled[0] = true; }
+        <<"test2">> [&]{ handled[1] = true; }
+        <<"test3">> [&]{ handled[2] = true; };
+
+    ASSERT_FALSE(handled[0]);
+    ASSERT_FALSE(handled[1]);
+    ASSERT_FALSE(handled[2]);
+}
+
+TEST(minijson_dispatch, absent_with_any_handler)
+{
+    bool handled[4] { };
+
+    using minijson::any;
+
+    minijson::dispatch("x")
+        <<"test1">> [&]{ handled[0] = true; }
+        <<"test2">> [&]{ handled[1] = true; }
+        <<"test3">> [&]{ handled[2] = true; }
+        <<any>>     [&]{ handled[3] = true; };
+
+    ASSERT_FALSE(handled[0]);
+    ASSERT_FALSE(handled[1]);
+    ASSERT_FALSE(handled[2]);
+    ASSERT_TRUE(handled[3]);
+}
+
+TEST(minijson_dispatch, std_string)
+{
+    const std::string x = "x";
+
+    bool handled = false;
+
+    minijson::dispatch(x)
+        <<x>> [&]{ handled = true; };
+
+    ASSERT_TRUE(handled);
+}
+
+TEST(minijson_dispatch, parse_object)
+{
+    char json_obj[] = "{ \"field1\": 42, \"array\" : [ 1, 2, 3 ], \"field2\": \"asd\", "
+            "\"nested\" : { \"field1\" : 42.0, \"field2\" : true, \"ignored_field\" : 0, \"ignored_object\" : {\"a\":[0]} },"
+            "\"ignored_array\" : [4, 2, {\"a\":5}, [7]] }";
+
+    struct obj_type
+    {
+        long field1 = 0;
+        std::string field2;
+        struct
+        {
+            double field1 = std::numeric_limits<double>::quiet_NaN();
+            bool field2 = false;
+        } nested;
+        std::vector<int> array;
+    };
+
+    obj_type obj;
+
+    using namespace minijson;
+
+    buffer_context ctx(json_obj, sizeof(json_obj) - 1);
+    parse_object(ctx, [&](const char* k, value v)
+    {
+        dispatch (k)
+        <<"field1">> [&]{ obj.field1 = v.as_long(); }
+        <<"field2">> [&]{ obj.field2 = v.as_string(); }
+        <<"nested">> [&]
+        {
+            parse_object(ctx, [&](const char* k, value v)
+            {
+                dispatch (k)
+                <<"field1">> [&]{ obj.nested.field1 = v.as_double(); }
+                <<"field2">> [&]{ obj.nested.field2 = v.as_bool(); }
+                <<any>> [&]{ ignore(ctx); };
+            });
+        }
+        <<"array">> [&]
+        {
+            parse_array(ctx, [&](value v) { obj.array.push_back(v.as_long()); });
+        }
+        <<any>> [&]{ ignore(ctx); };
+    });
+
+    ASSERT_EQ(42, obj.field1);
+    ASSERT_EQ("asd", obj.field2);
+    ASSERT_DOUBLE_EQ(42.0, obj.nested.field1);
+    ASSERT_TRUE(obj.nested.field2);
+    ASSERT_EQ(3U, obj.array.size());
+    ASSERT_EQ(1, obj.array[0]);
+    ASSERT_EQ(2, obj.array[1]);
+    ASSERT_EQ(3, obj.array[2]);
+}
+
+
+static_assert(minijson::static_key("").hash() == 2166136261u, "FNV-1a offset basis");
+static_assert(minijson::static_key("a").hash() == 0xE40C292Cu, "FNV-1a of \"a\"");
+
+TEST(minijson_static_dispatch, key_hash)
+{
+    using namespace minijson::literals;
+
+    constexpr minijson::static_key key("field1");
+    static_assert(key.length() == 6, "static_key length");
+    static_assert(key.hash() == "field1"_key.hash(), "static_key hash");
+
+    const char* const names[] = { "", "a", "field1", "\xE4\xBD\xA0\xE5\xA5\xBD", "a much longer field name, just in case" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        ASSERT_EQ(minijson::detail::key_hash(names[i], strlen(names[i])), minijson::detail::runtime_key_hash(names[i], strlen(names[i])));
+    }
+}
+
+TEST(minijson_static_dispatch, present)
+{
+    using namespace minijson::literals;
+
+    bool handled[4] { };
+
+    minijson::static_dispatch("test2")
+        <<"test1"_key>> [&]{ handled[0] = true; }
+        <<"test2"_key>> [&]{ handled[1] = true; } // should "break" here
+        <<"test3"_key>> [&]{ handled[2] = true; }
+        <<"test2"_key>> [&]{ handled[3] = true; };
+
+    ASSERT_FALSE(handled[0]);
+    ASSERT_TRUE(handled[1]);
+    ASSERT_FALSE(handled[2]);
+    ASSERT_FALSE(handled[3]);
+}
+
+TEST(minijson_static_dispatch, absent_with_any_handler)
+{
+    using namespace minijson::literals;
+    using minijson::any;
+
+    bool handled[4] { };
+
+    minijson::static_dispatch("test")
+        <<"test1"_key>> [&]{ handled[0] = true; }
+        <<"tes"_key>>   [&]{ handled[1] = true; }
+        <<"test\0"_key>> [&]{ handled[2] = true; } // same prefix, different length
+        <<any>>         [&]{ handled[3] = true; };
+
+    ASSERT_FALSE(handled[0]);
     ASSERT_FALSE(handled[1]);
     ASSERT_FALSE(handled[2]);
     ASSERT_TRUE(handled[3]);
 }
 
-TEST(minijson_dispatch, std_string)
+TEST(minijson_static_dispatch, runtime_keys)
+{
+    using namespace minijson::literals;
+
+    const std::string x = "x";
+    const char* const y = "y";
+
+    bool handled[2] { };
+
+    minijson::static_dispatch(x)
+        <<y>>      [&]{ handled[0] = true; }
+        <<"x"_key>> [&]{ handled[1] = true; };
+
+    ASSERT_FALSE(handled[0]);
+    ASSERT_TRUE(handled[1]);
+}
+
+TEST(minijson_static_dispatch, parse_object)
+{
+    char json_obj[] = "{ \"field1\": 42, \"array\" : [ 1, 2, 3 ], \"field2\": \"asd\", \"ignored\": {\"field1\": 0} }";
+
+    long field1 = 0;
+    std::string field2;
+    std::vector<long> array;
+
+    using namespace minijson;
+    using namespace minijson::literals;
+
+    buffer_context ctx(json_obj, sizeof(json_obj) - 1);
+    parse_object(ctx, [&](const char* k, value v)
+    {
+        static_dispatch (k)
+        <<"field1"_key>> [&]{ field1 = v.as_long(); }
+        <<"field2"_key>> [&]{ field2 = v.as_string(); }
+        <<"array"_key>>  [&]{ parse_array(ctx, [&](value v) { array.push_back(v.as_long()); }); }
+        <<any>>          [&]{ ignore(ctx); };
+    });
+
+    ASSERT_EQ(42, field1);
+    ASSERT_EQ("asd", field2);
+    ASSERT_EQ(3U, array.size());
+    ASSERT_EQ(3, array[2]);
+}
+
+TEST(minijson_static_dispatch, parse_object_key)
+{
+    char json_obj[] = "{ \"field1\": 42, \"field2\": \"asd\", \"field3\": 0 }";
+
+    long field1 = 0;
+    std::string field2;
+    std::string ignored;
+
+    using namespace minijson;
+    using namespace minijson::literals;
+
+    buffer_context ctx(json_obj, sizeof(json_obj) - 1);
+    parse_object(ctx, [&](const key& k, value v)
+    {
+        static_dispatch (k) // uses the hash of the key
+        <<"field1"_key>> [&]{ field1 = v.as_long(); }
+        <<"field2"_key>> [&]{ field2 = v.as_string(); }
+        <<any>>          [&]{ ignored += k; };
+    });
+
+    ASSERT_EQ(42, field1);
+    ASSERT_EQ("asd", field2);
+    ASSERT_EQ("field3", ignored);
+}
+
+#endif // MJR_CPP11_SUPPORTED
+
+#if MJR_CPP11_SUPPORTED
+
+// n lines, with blank lines and CRLF line endings here and there
+static std::string ndjson_lines(size_t n)
+{
+    std::string result;
+    for (size_t i = 0; i < n; i++)
+    {
+        std::ostringstream line;
+        line << "{\"i\":" << i << ",\"s\":\"" << std::string(i % 50, 'x') << "\"}";
+        result += line.str();
+        result += (i % 7 == 0) ? "\r\n" : "\n";
+        if (i % 11 == 0)
+        {
+            result += " \t\n";
+        }
+    }
+
+    return result;
+}
+
+static long parse_ndjson_line(minijson::buffer_context& context)
+{
+    long i = -1;
+    minijson::parse_object(context, [&](const char* name, minijson::value value)
+    {
+        if (std::strcmp(name, "i") == 0)
+        {
+            i = value.as_long();
+        }
+    });
+
+    return i;
+}
+
+TEST(minijson_ndjson, split_lines)
+{
+    const std::string input = "a\nbb\nccc\n\nd";
+    const std::vector<size_t> boundaries = minijson::detail::split_lines(input.data(), input.size(), 3);
+
+    const size_t expected[] = { 0, 5, 9, 11 }; // batches end right after a newline
+    ASSERT_EQ(std::vector<size_t>(expected, expected + 4), boundaries);
+    ASSERT_EQ(std::vector<size_t>(1, 0), minijson::detail::split_lines("", 0, 3));
+}
+
+TEST(minijson_ndjson, parse_ndjson)
+{
+    const size_t n = 10000;
+    const std::string input = ndjson_lines(n);
+
+    const size_t threads[] = { 1, 2, 8 };
+    const size_t batch_sizes[] = { 0, 1, 1000 };
+    for (size_t t = 0; t < 3; t++)
+    {
+        for (size_t b = 0; b < 3; b++)
+        {
+            std::vector<std::atomic<int>> seen(n);
+            std::atomic<long> sum(0);
+            minijson::parse_ndjson(input.data(), input.size(), [&](minijson::buffer_context& context, size_t offset)
+            {
+                const long i = parse_ndjson_line(context);
+                seen[i]++;
+                sum += i;
+                ASSERT_EQ('{', input[offset]);
+            }, threads[t], batch_sizes[b]);
+
+            ASSERT_EQ(static_cast<long>(n * (n - 1) / 2), sum.load());
+            for (size_t i = 0; i < n; i++)
+            {
+                ASSERT_EQ(1, seen[i].load());
+            }
+        }
+    }
+
+    // the first error is rethrown, after stopping all the threads
+    const std::string invalid = input + "{\"i\":}\n" + input;
+    ASSERT_THROW(minijson::parse_ndjson(invalid.data(), invalid.size(), [&](minijson::buffer_context& context, size_t)
+    {
+        parse_ndjson_line(context);
+    }, 4, 1000), minijson::parse_error);
+}
+
+TEST(minijson_ndjson, parse_ndjson_ordered)
+{
+    const size_t n = 10000;
+    const std::string input = ndjson_lines(n);
+
+    const size_t threads[] = { 1, 2, 8 };
+    const size_t batch_sizes[] = { 0, 1, 1000 };
+    for (size_t t = 0; t < 3; t++)
+    {
+        for (size_t b = 0; b < 3; b++)
+        {
+            std::vector<long> results;
+            minijson::parse_ndjson_ordered(input.data(), input.size(),
+                [&](minijson::buffer_context& context, size_t) { return parse_ndjson_line(context); },
+                [&](long i) { results.push_back(i); },
+                threads[t], batch_sizes[b]);
+
+            ASSERT_EQ(n, results.size());
+            for (size_t i = 0; i < n; i++)
+            {
+                ASSERT_EQ(static_cast<long>(i), results[i]);
+            }
+        }
+    }
+
+    // the lines before the invalid one are consumed, then the error is rethrown
+    const std::string invalid = input + "{\"i\":}\n" + input;
+    std::vector<long> results;
+    ASSERT_THROW(minijson::parse_ndjson_ordered(invalid.data(), invalid.size(),
+        [&](minijson::buffer_context& context, size_t) { return parse_ndjson_line(context); },
+        [&](long i) { results.push_back(i); },
+        4, 1000), minijson::parse_error);
+    ASSERT_EQ(n, results.size());
+
+    // exceptions thrown by the consumer stop the threads as well
+    size_t consumed = 0;
+    ASSERT_THROW(minijson::parse_ndjson_ordered(input.data(), input.size(),
+        [&](minijson::buffer_context& context, size_t) { return parse_ndjson_line(context); },
+        [&](long i) { consumed++; if (i == 100) throw std::runtime_error("stop"); },
+        4, 1000), std::runtime_error);
+    ASSERT_EQ(101U, consumed);
+}
+
+#ifdef MJR_MMAP_SUPPORTED
+
+TEST(minijson_ndjson, mapped_file)
+{
+    const temporary_file file(ndjson_lines(100));
+    const minijson::mapped_file mapped_file(file.path());
+
+    std::atomic<long> sum(0);
+    minijson::parse_ndjson(mapped_file.data(), mapped_file.size(), [&](minijson::buffer_context& context, size_t)
+    {
+        sum += parse_ndjson_line(context);
+    });
+    ASSERT_EQ(4950, sum.load());
+}
+
+#endif // MJR_MMAP_SUPPORTED
+
+#endif // MJR_CPP11_SUPPORTED
+
+#if MJR_CPP11_SUPPORTED && defined(MJR_MMAP_SUPPORTED)
+
+// the directory of this file, which contains the files directory of the examples
+static std::string source_directory()
+{
+    const std::string path = __FILE__;
+    const size_t slash = path.rfind('/');
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+}
+
+// what finder::start() returns for the offset, without its output
+static std::string find_by_parsing(nested_json::finder& finder)
+{
+    std::string output;
+    nested_json::text_sink sink(output);
+    finder.set_sink(sink);
+    return finder.start();
+}
+
+TEST(nested_json_offset_index, files)
+{
+    size_t failed = 0;
+    const std::vector<std::string> files = nested_json::expand_file_patterns(
+        std::vector<std::string>(1, source_directory() + "files/*.json"), failed);
+    ASSERT_FALSE(files.empty());
+    ASSERT_EQ(0U, failed);
+
+    for (const std::string& file : files)
+    {
+        const minijson::mapped_file mapped_file(file);
+        nested_json::offset_index index(file);
+        index.build();
+        nested_json::finder indexed(file, 0);
+        for (size_t offset = 0; offset <= mapped_file.size() + 1; offset++)
+        {
+            nested_json::finder finder(file, offset);
+            const std::string expected = find_by_parsing(finder);
+            ASSERT_EQ(expected, index.path(offset)) << file << " " << offset;
+            ASSERT_EQ(expected, indexed.find(offset)) << file << " " << offset;
+        }
+    }
+}
+
+TEST(nested_json_offset_index, buffers)
+{
+    const char* const documents[] =
+    {
+        "{\"a\":{\"b\\\"c\":[1,[2,{\"d\\u00e9\":3}],{}],\"e\":[]},\"f\":null,\"\":{\"g\":\"h\"}}",
+        " [[],{\"x\":[true]},\"s\", 12 ,[[[0]]]] ",
+        "{}",
+    };
+
+    for (const char* document : documents)
+    {
+        const int length = std::strlen(document);
+        nested_json::offset_index index(document, length);
+        index.build();
+        for (int offset = 0; offset <= length + 1; offset++)
+        {
+            nested_json::finder finder(document, length, offset);
+            ASSERT_EQ(find_by_parsing(finder), index.path(offset)) << document << " " << offset;
+        }
+    }
+
+    const char document[] = "{\"a\":{\"b\\\"c\":[1,[2,{\"d\\u00e9\":3}]]}}";
+    nested_json::offset_index index(document, sizeof(document) - 1);
+    index.build();
+    ASSERT_EQ(7U, index.entries().size());
+    const size_t position = index.find(std::strchr(document, '3') - document);
+    ASSERT_EQ(6U, position);
+    ASSERT_EQ(".a.b\"c[1][1].d\xC3\xA9", index.path(index.entries()[position].begin_offset));
+    ASSERT_EQ(16U, sizeof(nested_json::offset_index::entry));
+}
+
+TEST(nested_json_path_builder, push_pop)
+{
+    nested_json::path_builder path;
+    ASSERT_EQ(0U, path.depth());
+    ASSERT_EQ("", path.str());
+
+    path.push("");
+    path.push_key("k4");
+    path.push_index(0);
+    path.push_index(1234567890);
+    path.push_key("");
+    ASSERT_EQ(5U, path.depth());
+    ASSERT_EQ(".k4[0][1234567890].", path.str());
+    ASSERT_EQ(".", path.back().to_string());
+    ASSERT_EQ(path.str(), path.view().to_string());
+
+    path.pop();
+    ASSERT_EQ("[1234567890]", path.back().to_string());
+    path.pop();
+    ASSERT_EQ(".k4[0]", path.str());
+    path.push_index(static_cast<size_t>(-1));
+    ASSERT_EQ("[" + std::to_string(static_cast<size_t>(-1)) + "]", path.back().to_string());
+    path.pop();
+    path.push_key("u");
+    ASSERT_EQ(".k4[0].u", path.str());
+
+    std::ostringstream stream;
+    stream << path.view();
+    ASSERT_EQ(".k4[0].u", stream.str());
+
+    // the segments are truncated, not reallocated
+    const char* const data = path.view().data;
+    path.pop();
+    path.pop();
+    path.push_key("ab");
+    ASSERT_EQ(data, path.view().data);
+    ASSERT_EQ(".k4.ab", path.str());
+
+    path.clear();
+    ASSERT_EQ(0U, path.depth());
+    ASSERT_EQ(0U, path.view().size);
+    path.push(".");
+    path.push_index(10);
+    ASSERT_EQ(".[10]", path.str());
+    ASSERT_EQ(2U, path.depth());
+}
+
+// what parser writes through a Sink for the document, with a buffer of the given size
+template<typename Sink>
+static std::string flatten(const std::string& document, size_t buffer_size = nested_json::sink::DEFAULT_BUFFER_SIZE)
+{
+    std::string output;
+    {
+        Sink sink(output, buffer_size);
+        nested_json::parser parser(document.data(), document.size());
+        parser.set_sink(sink);
+        parser.start();
+    }
+    return output;
+}
+
+TEST(nested_json_sink, tsv_escaping)
+{
+    const std::string document =
+        "{\"t\\tk\":\"a\\tb\",\"n\":\"c\\nd\\re\",\"b\\\\\":\"f\\\\g\\\\\",\"q\":\"\\\"h\\\"\","
+        "\"c\":\"\\u0001\\u001f\\u007f\",\"u\":\"\\u00e9\",\"x\":[1.5,true,null]}";
+    const std::string expected =
+        ".t\\tk\ta\\tb\tstring\n"
+        ".n\tc\\nd\\re\tstring\n"
+        ".b\\\\\tf\\\\g\\\\\tstring\n"
+        ".q\t\"h\"\tstring\n"
+        ".c\t\x01\x1f\x7f\tstring\n" // only tabs, newlines, carriage returns and backslashes are escaped
+        ".u\t\xC3\xA9\tstring\n"
+        ".x[0]\t1.5\tnumber\n"
+        ".x[1]\ttrue\tboolean\n"
+        ".x[2]\tnull\tnull\n";
+
+    ASSERT_EQ(expected, flatten<nested_json::tsv_sink>(document));
+    ASSERT_EQ(expected, flatten<nested_json::tsv_sink>(document, 1));
+    ASSERT_EQ(expected, flatten<nested_json::tsv_sink>(document, 3));
+}
+
+TEST(nested_json_sink, ndjson_escaping)
+{
+    const std::string document =
+        "{\"t\\tk\":\"a\\tb\",\"n\":\"c\\nd\\re\",\"b\\\\\":\"f\\\\g\\\\\",\"q\\\"\":\"\\\"h\\\"\","
+        "\"c\":\"\\u0000\\u0001\\b\\f\\u001f \\u007f\",\"u\":\"\\u00e9/\",\"x\":[1.5e3,true,null,\"\"]}";
+    const std::string expected =
+        "{\"path\":\".t\\tk\",\"value\":\"a\\tb\"}\n"
+        "{\"path\":\".n\",\"value\":\"c\\nd\\re\"}\n"
+        "{\"path\":\".b\\\\\",\"value\":\"f\\\\g\\\\\"}\n"
+        "{\"path\":\".q\\\"\",\"value\":\"\\\"h\\\"\"}\n"
+        "{\"path\":\".c\",\"value\":\"\"}\n" // the value is a C string: it ends at the NUL
+        "{\"path\":\".u\",\"value\":\"\xC3\xA9/\"}\n"
+        "{\"path\":\".x[0]\",\"value\":1.5e3}\n"
+        "{\"path\":\".x[1]\",\"value\":true}\n"
+        "{\"path\":\".x[2]\",\"value\":null}\n"
+        "{\"path\":\".x[3]\",\"value\":\"\"}\n";
+
+    ASSERT_EQ(expected, flatten<nested_json::ndjson_sink>(document));
+    ASSERT_EQ(expected, flatten<nested_json::ndjson_sink>(document, 1));
+    ASSERT_EQ(expected, flatten<nested_json::ndjson_sink>(document, 3));
+
+    // control characters other than \t, \n and \r are written as \u00XX
+    const std::string controls = "{\"c\":\"\\u0001\\b\\f\\u001f \\u007f\"}";
+    ASSERT_EQ("{\"path\":\".c\",\"value\":\"\\u0001\\u0008\\u000c\\u001f \x7f\"}\n",
+        flatten<nested_json::ndjson_sink>(controls));
+}
+
+TEST(nested_json_batch, expand_file_patterns)
+{
+    const temporary_file file("{}");
+
+    std::vector<std::string> patterns;
+    patterns.push_back("no such file.json"); // kept as it is
+    patterns.push_back(file.path() + "*");
+    patterns.push_back(file.path() + "*.none");
+    patterns.push_back(file.path() + "[");
+
+    size_t failed = 0;
+    testing::internal::CaptureStderr();
+    const std::vector<std::string> files = nested_json::expand_file_patterns(patterns, failed);
+    const std::string errors = testing::internal::GetCapturedStderr();
+
+    ASSERT_EQ(2U, files.size());
+    ASSERT_EQ("no such file.json", files[0]);
+    ASSERT_EQ(file.path(), files[1]);
+    ASSERT_EQ(2U, failed);
+    ASSERT_NE(std::string::npos, errors.find(file.path() + "*.none: "));
+    ASSERT_NE(std::string::npos, errors.find(file.path() + "[: "));
+}
+
+// what run_batch writes to a file, with the number of failures
+template<typename MakeWorker>
+static std::pair<std::string, size_t> run_batch(const std::vector<std::string>& files, size_t thread_count, bool ordered, MakeWorker make_worker)
+{
+    const temporary_file output("");
+    const int fd = open(output.path().c_str(), O_WRONLY | O_TRUNC);
+    EXPECT_NE(-1, fd);
+
+    testing::internal::CaptureStderr();
+    const size_t failed = nested_json::run_batch(files, thread_count, ordered, fd, make_worker);
+    testing::internal::GetCapturedStderr();
+    close(fd);
+
+    std::ifstream stream(output.path().c_str());
+    const std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return std::make_pair(contents, failed);
+}
+
+// splits the output of flatten_worker into the outputs of the files, in order
+static std::vector<std::string> split_outputs(const std::string& output)
 {
-    const std::string x = "x";
+    std::vector<std::string> outputs;
+    for (size_t begin = 0; begin < output.size(); )
+    {
+        const size_t end = std::min(output.find("==> ", begin + 1), output.size());
+        outputs.push_back(output.substr(begin, end - begin));
+        begin = end;
+    }
+    return outputs;
+}
 
-    bool handled = false;
+TEST(nested_json_batch, run_batch)
+{
+    std::vector<std::unique_ptr<temporary_file>> temporary_files;
+    std::vector<std::string> files;
+    for (size_t i = 0; i < 40; i++)
+    {
+        std::string document;
+        if (i == 7)
+        {
+            document = "{\"a\":1,\"b\":[2,"; // fails
+        }
+        else
+        {
+            document = "{\"file\":" + std::to_string(i) + ",\"values\":[";
+            for (size_t j = 0; j < i * 50; j++)
+            {
+                document += (j == 0 ? "" : ",") + std::to_string(j);
+            }
+            document += "]}";
+        }
+        temporary_files.push_back(std::unique_ptr<temporary_file>(new temporary_file(document)));
+        files.push_back(temporary_files.back()->path());
+    }
+    files.push_back("/nonexistent/minijson_reader_tests.json"); // fails too
 
-    minijson::dispatch(x)
-        <<x>> [&]{ handled = true; };
+    // the output of each file on its own, "" for those that fail
+    std::string expected;
+    std::vector<std::string> expected_outputs;
+    nested_json::flatten_worker<nested_json::text_sink> worker;
+    for (const std::string& file : files)
+    {
+        std::string output;
+        try
+        {
+            worker(file, output);
+        }
+        catch (const std::exception&)
+        {
+            ASSERT_TRUE(file == files[7] || file == files.back());
+            continue;
+        }
+        expected += output;
+        expected_outputs.push_back(output);
+    }
+    ASSERT_EQ(files.size() - 2, expected_outputs.size());
 
-    ASSERT_TRUE(handled);
+    const auto make_worker = []()
+    {
+        return std::unique_ptr<nested_json::flatten_worker<nested_json::text_sink>>(new nested_json::flatten_worker<nested_json::text_sink>());
+    };
+
+    for (size_t thread_count = 1; thread_count <= 8; thread_count *= 2)
+    {
+        const std::pair<std::string, size_t> ordered = run_batch(files, thread_count, true, make_worker);
+        ASSERT_EQ(expected, ordered.first) << thread_count;
+        ASSERT_EQ(2U, ordered.second);
+
+        const std::pair<std::string, size_t> unordered = run_batch(files, thread_count, false, make_worker);
+        std::vector<std::string> outputs = split_outputs(unordered.first);
+        std::sort(outputs.begin(), outputs.end());
+        std::vector<std::string> sorted_expected_outputs = expected_outputs;
+        std::sort(sorted_expected_outputs.begin(), sorted_expected_outputs.end());
+        ASSERT_EQ(sorted_expected_outputs, outputs) << thread_count;
+        ASSERT_EQ(2U, unordered.second);
+    }
+
+    // the same offset in every file
+    const std::pair<std::string, size_t> found = run_batch(files, 4, true, []()
+    {
+        return std::unique_ptr<nested_json::find_worker>(new nested_json::find_worker(9));
+    });
+    std::string expected_found;
+    for (size_t i = 0; i + 1 < files.size(); i++)
+    {
+        if (i != 7)
+        {
+            expected_found += files[i] + "\t.file\n";
+        }
+    }
+    ASSERT_EQ(expected_found, found.first);
+    ASSERT_EQ(2U, found.second);
 }
 
-TEST(minijson_dispatch, parse_object)
+#endif // MJR_CPP11_SUPPORTED && MJR_MMAP_SUPPORTED
+
+#ifdef MJR_COROUTINES_SUPPORTED
+
+// records the events in the same format as pull_recorder, returns the number of events
+size_t record_events(minijson::event_generator events, std::string& recorded, size_t max_events = SIZE_MAX)
 {
-    char json_obj[] = "{ \"field1\": 42, \"array\" : [ 1, 2, 3 ], \"field2\": \"asd\", "
-            "\"nested\" : { \"field1\" : 42.0, \"field2\" : true, \"ignored_field\" : 0, \"ignored_object\" : {\"a\":[0]} },"
-            "\"ignored_array\" : [4, 2, {\"a\":5}, [7]] }";
+    size_t count = 0;
+    size_t nesting_level = 0;
+    const char* name = NULL;
+    for (const minijson::event& e : events)
+    {
+        if (count++ == max_events)
+        {
+            break;
+        }
 
-    struct obj_type
+        switch (e.type)
+        {
+        case minijson::Key:
+            name = e.name;
+            break;
+        case minijson::BeginObject:
+        case minijson::BeginArray:
+            if (nesting_level > 0)
+            {
+                record_event(recorded, nesting_level, name, minijson::value(e.type == minijson::BeginObject ? minijson::Object : minijson::Array));
+            }
+            nesting_level++;
+            name = NULL;
+            break;
+        case minijson::EndObject:
+        case minijson::EndArray:
+            nesting_level--;
+            break;
+        case minijson::Scalar:
+            record_event(recorded, nesting_level, name, e.scalar);
+            name = NULL;
+            break;
+        }
+    }
+
+    return count;
+}
+
+TEST(minijson_event_generator, same_events)
+{
+    const char* const inputs[] =
     {
-        long field1 = 0;
-        std::string field2;
-        struct
+        "{\"a\":[1,{\"b\":[true,null,\"\\u00e8\"]},-2.5e3],\"c\":{}, \"\\ud83d\\ude00\\\"\" : \"x\\\\y\\/\\n\"}",
+        "[[[]],{},\"x\",[{\"y\":[0]}], false ,\"\", 12345678901234567890, 0.1e-2]",
+        " \t\r\n{ \"k\" \n: \n[ ] \n} ",
+        "[]",
+    };
+
+    for (const char* input : inputs)
+    {
+        std::string expected;
         {
-            double field1 = std::numeric_limits<double>::quiet_NaN();
-            bool field2 = false;
-        } nested;
-        std::vector<int> array;
+            minijson::const_buffer_context context(input, strlen(input));
+            if (std::string(input).find('{') < std::string(input).find('['))
+            {
+                minijson::parse_object(context, pull_recorder<minijson::const_buffer_context>(context, expected, 1));
+            }
+            else
+            {
+                minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, expected, 1));
+            }
+        }
+
+        std::string events;
+        minijson::const_buffer_context buffer_context(input, strlen(input));
+        record_events(minijson::parse_events(buffer_context), events);
+        ASSERT_EQ(expected, events) << input;
+
+        events.clear();
+        std::istringstream stream(input);
+        minijson::istream_context istream_context(stream);
+        record_events(minijson::parse_events(istream_context), events);
+        ASSERT_EQ(expected, events) << input;
+    }
+}
+
+TEST(minijson_event_generator, nested)
+{
+    const char input[] = "{\"a\":1,\"b\":[2,{\"c\":3}],\"d\":4}";
+    minijson::const_buffer_context context(input, sizeof(input) - 1);
+
+    std::string events;
+    minijson::parse_object(context, [&](const char* name, minijson::value value)
+    {
+        if (value.type() == minijson::Array)
+        {
+            record_events(minijson::parse_events(context), events);
+        }
+        else
+        {
+            record_event(events, 0, name, value);
+        }
+    });
+    ASSERT_EQ("0 a 1 1;1 - 1 2;1 - 3 ;2 c 1 3;0 d 1 4;", events); // nesting level, name, type and value
+}
+
+TEST(minijson_event_generator, stop_early)
+{
+    const char input[] = "[1,2,3,4,5,6,7,8,9]";
+    minijson::const_buffer_context context(input, sizeof(input) - 1);
+
+    std::string events;
+    ASSERT_EQ(4U, record_events(minijson::parse_events(context), events, 3));
+    ASSERT_EQ("1 - 1 1;1 - 1 2;", events);
+    ASSERT_EQ(7U, context.read_offset()); // nothing is read past the fourth event
+}
+
+TEST(minijson_event_generator, errors)
+{
+    const char* const inputs[] =
+    {
+        "{\"x\":8.2e+62738}",
+        "[0x1273]",
+        "{\"x\":nuxl}",
+        "[\"\\ud800x\"]",
+        "{\"a\":[1,{\"b\":[true,nul]}]}",
+        "[{\"a\":[1,2,{\"b\":3,}]}]",
+        "{\"a\":[1,2 3]}",
+        "{\"a\":[1,2}}",
+        "{\"a\" 1}",
+        "{1:2}",
+        "x",
+        "[1,2",
+        "{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":["
+        "]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}",
     };
 
-    obj_type obj;
+    for (const char* input : inputs)
+    {
+        std::string expected_events;
+        minijson::parse_error expected(minijson::parse_error::UNKNOWN, 0);
+        try
+        {
+            minijson::const_buffer_context context(input, strlen(input));
+            if (input[0] == '[')
+            {
+                minijson::parse_array(context, pull_recorder<minijson::const_buffer_context>(context, expected_events, 1));
+            }
+            else
+            {
+                minijson::parse_object(context, pull_recorder<minijson::const_buffer_context>(context, expected_events, 1));
+            }
+        }
+        catch (const minijson::parse_error& e)
+        {
+            expected = e;
+        }
+        ASSERT_NE(minijson::parse_error::UNKNOWN, expected.reason()) << input;
 
-    using namespace minijson;
+        std::string events;
+        minijson::const_buffer_context context(input, strlen(input));
+        try
+        {
+            record_events(minijson::parse_events(context), events);
+            FAIL() << input;
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(expected.reason(), e.reason()) << input;
+            ASSERT_EQ(expected.offset(), e.offset()) << input;
+        }
+        if (expected.reason() != minijson::parse_error::EXCEEDED_NESTING_LIMIT) // parse_object reports the object before failing
+        {
+            ASSERT_EQ(expected_events, events) << input;
+        }
+    }
+}
 
-    buffer_context ctx(json_obj, sizeof(json_obj) - 1);
-    parse_object(ctx, [&](const char* k, value v)
+#endif // MJR_COROUTINES_SUPPORTED
+
+#ifdef MJR_ENABLE_STRUCTURAL_INDEX
+
+// the tokens of a message and their matching closing brackets, found one byte at a time
+static void reference_structural_index(const std::string& input, std::vector<size_t>& offsets, std::vector<size_t>& closing)
+{
+    offsets.clear();
+    closing.clear();
+    std::vector<size_t> open_brackets;
+
+    bool in_string = false;
+    bool escaped = false;
+    bool previous_boundary = true;
+    for (size_t i = 0; i < input.size(); i++)
     {
-        dispatch (k)
-        <<"field1">> [&]{ obj.field1 = v.as_long(); }
-        <<"field2">> [&]{ obj.field2 = v.as_string(); }
-        <<"nested">> [&]
+        const char c = input[i];
+        const bool is_escaped = escaped;
+        escaped = !is_escaped && (c == '\\');
+
+        const bool quote = (c == '"') && !is_escaped;
+        if (quote)
         {
-            parse_object(ctx, [&](const char* k, value v)
+            in_string = !in_string;
+        }
+
+        const bool structural = (std::strchr("{}[]:,", c) != NULL) && (c != 0);
+        const bool boundary = (std::strchr(" \t\n\v\f\r", c) != NULL) || structural || quote || (c == 0);
+        const bool outside = !in_string || quote; // the opening quote is a token, the closing one is not
+        bool token;
+        if (quote)
+        {
+            token = in_string;
+        }
+        else
+        {
+            token = outside && (structural || (c == 0) || (!boundary && previous_boundary));
+        }
+        previous_boundary = boundary;
+
+        if (token)
+        {
+            if (is_escaped)
             {
-                dispatch (k)
-                <<"field1">> [&]{ obj.nested.field1 = v.as_double(); }
-                <<"field2">> [&]{ obj.nested.field2 = v.as_bool(); }
-                <<any>> [&]{ ignore(ctx); };
-            });
+                // invalid, and not paired
+            }
+            else if ((c == '{') || (c == '['))
+            {
+                open_brackets.push_back(offsets.size());
+            }
+            else if (((c == '}') || (c == ']')) && !open_brackets.empty())
+            {
+                closing[open_brackets.back()] = offsets.size();
+                open_brackets.pop_back();
+            }
+            offsets.push_back(i);
+            closing.push_back(0);
         }
-        <<"array">> [&]
+    }
+}
+
+static void check_structural_index(const std::string& input)
+{
+    std::vector<size_t> expected_offsets;
+    std::vector<size_t> expected_closing;
+    reference_structural_index(input, expected_offsets, expected_closing);
+
+    const minijson::structural_index index(input.data(), input.size());
+    ASSERT_EQ(expected_offsets.size(), index.size()) << input;
+    for (size_t i = 0; i < index.size(); i++)
+    {
+        ASSERT_EQ(expected_offsets[i], index.offset(i)) << input << " " << i;
+        ASSERT_EQ(expected_closing[i], index.closing(i)) << input << " " << i;
+    }
+}
+
+TEST(minijson_structural_index, tokens)
+{
+    const std::string input = " {\"a\\\"b\" : [1, 2.5 ,true], \"c\":{\"d\":null}, \"e\":\"x,y\"} ";
+    const minijson::structural_index index(input.data(), input.size());
+
+    const size_t expected_offsets[] = { 1, 2, 9, 11, 12, 13, 15, 19, 20, 24, 25, 27, 30, 31, 32, 35, 36, 40, 41, 43, 46, 47, 52 };
+    ASSERT_EQ(sizeof(expected_offsets) / sizeof(expected_offsets[0]), index.size());
+    for (size_t i = 0; i < index.size(); i++)
+    {
+        ASSERT_EQ(expected_offsets[i], index.offset(i));
+    }
+    ASSERT_EQ(22U, index.closing(0)); // {
+    ASSERT_EQ(9U, index.closing(3)); // [
+    ASSERT_EQ(17U, index.closing(13)); // {
+    ASSERT_EQ(0U, index.closing(1));
+
+    ASSERT_EQ(0U, index.next(0));
+    ASSERT_EQ(3U, index.next(10));
+    ASSERT_EQ(3U, index.next(11, 2));
+    ASSERT_EQ(13U, index.next(31, 4));
+    ASSERT_EQ(index.size(), index.next(53));
+
+    check_structural_index(input);
+    check_structural_index("");
+    check_structural_index("[\"unterminated");
+    check_structural_index("]}[{ \"\\\\\" tru\"e\" \\\"x [1 2] \v\f");
+    check_structural_index(std::string("[\"a\0b\", 1\0, \0]", 15));
+}
+
+TEST(minijson_structural_index, block_boundaries)
+{
+    // strings, escapes and values straddling the 64-byte blocks at every position
+    const char* const pieces[] = { "\"", "\\", "\\\\", "\\\"", "x", " ", "[", "]", "{", "}", ":", ",", "12", "\"a\\\"\"" };
+    const size_t piece_count = sizeof(pieces) / sizeof(pieces[0]);
+
+    uint32_t state = 1;
+    for (size_t n = 0; n < 300; n++)
+    {
+        std::string input;
+        while (input.size() < 64 * 5 + n % 64)
         {
-            parse_array(ctx, [&](value v) { obj.array.push_back(v.as_long()); });
+            state = state * 1103515245 + 12345;
+            input += pieces[(state >> 8) % piece_count];
         }
-        <<any>> [&]{ ignore(ctx); };
-    });
+        check_structural_index(input);
+    }
 
-    ASSERT_EQ(42, obj.field1);
-    ASSERT_EQ("asd", obj.field2);
-    ASSERT_DOUBLE_EQ(42.0, obj.nested.field1);
-    ASSERT_TRUE(obj.nested.field2);
-    ASSERT_EQ(3U, obj.array.size());
-    ASSERT_EQ(1, obj.array[0]);
-    ASSERT_EQ(2, obj.array[1]);
-    ASSERT_EQ(3, obj.array[2]);
+    const std::string long_name(70, 'n');
+    std::string nested;
+    for (size_t i = 0; i < 10; i++)
+    {
+        nested = "{\"" + long_name + "\\\\\":[" + nested + "," + std::string(60, ' ') + "1e5]}";
+    }
+    check_structural_index(nested);
+
+    minijson::structural_index index(nested.data(), nested.size());
+    ASSERT_EQ(index.size() - 1, index.closing(0));
+    index.build("[]", 2); // reuses the memory
+    ASSERT_EQ(2U, index.size());
+    ASSERT_EQ(1U, index.closing(0));
 }
 
-#endif // MJR_CPP11_SUPPORTED
+// walks the message like parse_collect_values, but ignores every other nested object or array
+template<typename Context>
+struct index_walk_handler
+{
+    Context& context;
+    std::string& output;
+    size_t& nested;
+
+    explicit index_walk_handler(Context& context, std::string& output, size_t& nested) :
+        context(context),
+        output(output),
+        nested(nested)
+    {
+    }
+
+    void operator()(const char* field_name, minijson::value value)
+    {
+        output += field_name;
+        output += ':';
+        operator()(value);
+    }
+
+    void operator()(minijson::value value)
+    {
+        if ((value.type() == minijson::Object) || (value.type() == minijson::Array))
+        {
+            if (nested++ % 2 == 1)
+            {
+                output += '~';
+                minijson::ignore(context);
+            }
+            else if (value.type() == minijson::Object)
+            {
+                output += '{';
+                minijson::parse_object(context, *this);
+                output += '}';
+            }
+            else
+            {
+                output += '[';
+                minijson::parse_array(context, *this);
+                output += ']';
+            }
+        }
+        else
+        {
+            output += value.as_string();
+            output += ';';
+        }
+    }
+};
+
+// the output of index_walk_handler, or the error
+template<typename Context>
+std::string index_walk(Context& context, const std::string& input)
+{
+    std::string output;
+    size_t nested = 0;
+    try
+    {
+        if (input.find_first_not_of(" \t\n\r") < input.size() && (input[input.find_first_not_of(" \t\n\r")] == '['))
+        {
+            minijson::parse_array(context, index_walk_handler<Context>(context, output, nested));
+        }
+        else
+        {
+            minijson::parse_object(context, index_walk_handler<Context>(context, output, nested));
+        }
+    }
+    catch (const minijson::parse_error& e)
+    {
+        std::ostringstream error;
+        error << output << " => " << e.what() << " at " << e.offset();
+        return error.str();
+    }
+
+    return output;
+}
+
+// the index changes nothing to the result, valid or not
+static void check_indexed_parse(const std::string& input)
+{
+    std::string expected;
+    {
+        minijson::const_buffer_context context(input.data(), input.size());
+        expected = index_walk(context, input);
+    }
+
+    const minijson::structural_index index(input.data(), input.size());
+    {
+        minijson::const_buffer_context context(input.data(), input.size());
+        context.set_index(index);
+        ASSERT_EQ(expected, index_walk(context, input)) << input;
+    }
+    {
+        std::vector<char> buffer(input.begin(), input.end());
+        buffer.push_back(0);
+        minijson::buffer_context context(&buffer[0], input.size());
+        context.set_index(index);
+        ASSERT_EQ(expected, index_walk(context, input)) << input;
+    }
+}
+
+TEST(minijson_structural_index, parse)
+{
+    const std::string valid[] =
+    {
+        "{\"a\":1,\"b\":[true, false ,null,-1.5e3 ,\"s\\\"\"], \"c\" : {\"d\":{\"e\":[[],[1,[2,{}]]]},\"f\":\"x\"}, \"g\":0}",
+        " [ 1 , {\"a\" :\t[ 2 ,\"]\" ] } ,\n[ [ \"\\\\\" ] ] , 3\r\n]\v",
+        "[1,[2],{\"x\":[3]},[4,[5,[6]]],7]",
+        "{\"long name, with \\\"quotes\\\" and [brackets]\":[{\"a\":[1,2,{\"b\":\"}\"}],   \"c\":[[[\"]]]\"], 123456], {}]}, "
+        "\"next\":{\"d\":[\"x\\\\\", \"{\"], \"e\": {\"f\": -0.5e-10, \"g\": [true,false,null]}},   \"last\" : [[], {}]}",
+    };
+
+    std::vector<std::string> inputs(valid, valid + sizeof(valid) / sizeof(valid[0]));
+    inputs.push_back("[" + std::string(100, ' ') + "123456789012345678901234567890" + std::string(100, '\n') + "]");
+
+    const char replacements[] = { '"', '\\', '{', '}', '[', ']', ',', ':', ' ', '\v', '1', 'x', 0 };
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+    {
+        for (size_t position = 0; position < valid[i].size(); position++)
+        {
+            for (size_t r = 0; r < sizeof(replacements); r++)
+            {
+                std::string mutated = valid[i];
+                mutated[position] = replacements[r];
+                inputs.push_back(mutated);
+            }
+
+            std::string truncated = valid[i];
+            truncated.erase(position, 1);
+            inputs.push_back(truncated);
+            inputs.push_back(valid[i].substr(0, position));
+        }
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        check_indexed_parse(inputs[i]);
+        if (HasFatalFailure())
+        {
+            return;
+        }
+    }
+}
+
+#endif // MJR_ENABLE_STRUCTURAL_INDEX
 
 int main(int argc, char** argv)
 {